@@ -0,0 +1,799 @@
+// Equal-time convergence benchmark for the CPU executor.
+//
+// For every test scene a high-sample reference is rendered once and cached on disk.
+// Each executor configuration is then run headless for a fixed wall-clock budget and
+// its RMSE/relMSE against the reference is sampled after every pass. Configurations are
+// run several times, in a rotated order after a warm-up, so no configuration always runs
+// first or cold.
+//
+// Results are compared in baseline/candidate pairs at equal time. A gated comparison
+// fails when the candidate's error is worse than the baseline's by more than the
+// measurement's own uncertainty, and the process then exits non-zero. Informational
+// comparisons are reported the same way but never fail the run. Where the platform
+// allows it, hardware counters while tracing are reported alongside each run; see
+// HardwareCounters for what each platform provides.
+//
+// With --heatmap-dir, each configuration's first run per scene also writes its per-pixel
+// cost heatmap there. This is the way to get the heatmap from a GPU build, whose viewer
+// has no CPU executor to show it.
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Core/Colour.h"
+#include "Core/Viewpoint.h"
+#include "Model/CpuExecutor.h"
+#include "Model/PathTracer.h"
+#include "Model/World.h"
+#include "View/Canvas.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <libproc.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#define REFERENCE_SPP 1024
+#define TIME_BUDGET_SECONDS 30.0
+#define RMSE_THRESHOLD 0.05
+#define REPEATS 3
+#define WARMUP_SECONDS 2.0
+
+// Two-sided 95%: a gated candidate fails only when it is this many standard errors worse
+#define REGRESSION_Z_SCORE 1.96
+
+// Keeps relMSE finite on black reference pixels
+#define REL_MSE_EPSILON 1e-2
+
+constexpr char REFERENCE_MAGIC[8] = "RTREF02";
+
+
+struct BenchmarkSettings {
+	std::string	m_cacheDir			= "bench_cache";
+	std::string	m_reportPath		= "convergence_report.json";
+	size_t		m_referenceSpp		= REFERENCE_SPP;
+	double		m_timeBudget		= TIME_BUDGET_SECONDS;
+	double		m_rmseThreshold		= RMSE_THRESHOLD;
+	size_t		m_repeats			= REPEATS;
+	double		m_warmup			= WARMUP_SECONDS;
+	std::string	m_heatmapDir		= "";	// empty: no cost heatmaps are written
+};
+
+struct BenchmarkScene {
+	std::string	m_name;
+	Viewpoint	m_viewpoint;
+};
+
+struct BenchmarkConfig {
+	std::string			m_name;
+	CpuExecutorOptions	m_options;
+};
+
+struct BenchmarkComparison {
+	std::string	m_baseline;		// config names
+	std::string	m_candidate;
+	bool		m_gated;
+};
+
+struct ErrorSample {
+	double	m_seconds;
+	size_t	m_spp;
+	double	m_rmse;
+	double	m_relMse;
+};
+
+// Totals over a run's tracing; negative if unavailable
+struct HardwareCounts {
+	int64_t	m_cacheMisses	= -1;
+	int64_t	m_cycles		= -1;
+	int64_t	m_instructions	= -1;
+};
+
+struct RunResult {
+	std::string					m_scene;
+	std::string					m_config;
+	size_t						m_repeat;
+	std::vector<ErrorSample>	m_curve;
+	double						m_timeToThreshold;	// negative if never reached
+	HardwareCounts				m_counts;
+};
+
+struct ComparisonResult {
+	std::string	m_scene;
+	std::string	m_baseline;
+	std::string	m_candidate;
+	bool		m_gated;
+	double		m_seconds;			// the equal time both sides are compared at
+	double		m_baselineRmse;		// mean over repeats
+	double		m_candidateRmse;
+	double		m_margin;			// largest difference explained by measurement noise
+	double		m_baselineSppPerSecond;
+	double		m_candidateSppPerSecond;
+	bool		m_passed;
+};
+
+// Counts hardware events while tracing, only between Start() and Stop().
+//
+// On Linux these are perf events for the calling thread and every thread it starts after
+// construction, so create the counters before the executor spins up its worker pool. They
+// are unavailable when perf_event_paranoid forbids them.
+//
+// macOS gives unprivileged processes no cache-miss counter, only process-wide cycles and
+// instructions through proc_pid_rusage, so cache misses are reported as null there and
+// cycles per sample stand in for memory stalls. For real cache-miss counts, run the
+// benchmark under the CPU Counters instrument:
+//   xctrace record --template 'CPU Counters' --launch -- ./convergence_benchmark
+class HardwareCounters {
+public:
+	HardwareCounters() {
+#if defined(__linux__)
+		m_cacheMisses = Open(PERF_COUNT_HW_CACHE_MISSES);
+		m_cycles = Open(PERF_COUNT_HW_CPU_CYCLES);
+		m_instructions = Open(PERF_COUNT_HW_INSTRUCTIONS);
+#elif defined(__APPLE__)
+		rusage_info_v4 usage;
+		m_available = ReadUsage(usage);
+#endif
+	}
+
+	~HardwareCounters() {
+#if defined(__linux__)
+		for (int fd : { m_cacheMisses, m_cycles, m_instructions }) {
+			if (fd >= 0) close(fd);
+		}
+#endif
+	}
+
+	HardwareCounters(const HardwareCounters&) = delete;
+	HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+	void Start() {
+#if defined(__linux__)
+		for (int fd : { m_cacheMisses, m_cycles, m_instructions }) {
+			if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#elif defined(__APPLE__)
+		rusage_info_v4 usage;
+		if (m_available && ReadUsage(usage)) {
+			m_startCycles = usage.ri_cycles;
+			m_startInstructions = usage.ri_instructions;
+		}
+#endif
+	}
+
+	void Stop() {
+#if defined(__linux__)
+		for (int fd : { m_cacheMisses, m_cycles, m_instructions }) {
+			if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+		}
+#elif defined(__APPLE__)
+		rusage_info_v4 usage;
+		if (m_available && ReadUsage(usage)) {
+			m_cycles += usage.ri_cycles - m_startCycles;
+			m_instructions += usage.ri_instructions - m_startInstructions;
+		}
+#endif
+	}
+
+	HardwareCounts Read() const {
+		HardwareCounts counts;
+#if defined(__linux__)
+		counts.m_cacheMisses = ReadCounter(m_cacheMisses);
+		counts.m_cycles = ReadCounter(m_cycles);
+		counts.m_instructions = ReadCounter(m_instructions);
+#elif defined(__APPLE__)
+		if (m_available) {
+			counts.m_cycles = static_cast<int64_t>(m_cycles);
+			counts.m_instructions = static_cast<int64_t>(m_instructions);
+		}
+#endif
+		return counts;
+	}
+
+private:
+#if defined(__linux__)
+	static int Open(uint64_t config) {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.inherit = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+
+	static int64_t ReadCounter(int fd) {
+		uint64_t count = 0;
+		if (fd >= 0 && read(fd, &count, sizeof(count)) == sizeof(count)) return static_cast<int64_t>(count);
+		return -1;
+	}
+
+	int	m_cacheMisses;
+	int	m_cycles;
+	int	m_instructions;
+#elif defined(__APPLE__)
+	static bool ReadUsage(rusage_info_v4& usage) {
+		return proc_pid_rusage(getpid(), RUSAGE_INFO_V4, reinterpret_cast<rusage_info_t*>(&usage)) == 0;
+	}
+
+	bool		m_available			= false;
+	uint64_t	m_startCycles		= 0;
+	uint64_t	m_startInstructions	= 0;
+	uint64_t	m_cycles			= 0;
+	uint64_t	m_instructions		= 0;
+#endif
+};
+
+static std::vector<BenchmarkScene> GetScenes() {
+	return {
+		{ "default", Viewpoint{ Vector{ 0.0f, 0.0f, 0.0f }, Vector{ 0.0f, 0.0f, 0.0f } } },
+		{ "corner", Viewpoint{ Vector{ 0.3f, 0.25f, -0.5f }, Vector{ -0.5f, -0.3f, 0.0f } } },
+	};
+}
+
+static std::vector<BenchmarkConfig> GetConfigs() {
+	CpuExecutorOptions defaults{};
+
+	CpuExecutorOptions smallTiles{};
+	smallTiles.m_tileSize = 16;
+
+	CpuExecutorOptions largeTiles{};
+	largeTiles.m_tileSize = 64;
+
+	CpuExecutorOptions staticTiles{};
+	staticTiles.m_costSchedule = false;
+
+	CpuExecutorOptions noGBuffer{};
+	noGBuffer.m_gBufferCache = false;
+
+	CpuExecutorOptions radianceCache{};
+	radianceCache.m_radianceCache = true;
+
+	CpuExecutorOptions rowMajor{};
+	rowMajor.m_tiledLayout = false;
+
+	return {
+		{ "default", defaults },
+		{ "tile-16", smallTiles },
+		{ "tile-64", largeTiles },
+		{ "static-tiles", staticTiles },
+		{ "no-gbuffer", noGBuffer },
+		{ "radiance-cache", radianceCache },
+		{ "row-major", rowMajor },
+	};
+}
+
+// A feature that is on by default is gated as the candidate against the same config with
+// it switched off, so the gate catches the feature regressing rather than failing when it helps.
+// Tile size is a tuning choice rather than a feature, so those comparisons only inform.
+// The radiance cache is biased and is expected to lose to the unbiased tracer in some
+// scenes, so its quality and speed are reported without gating.
+static std::vector<BenchmarkComparison> GetComparisons() {
+	return {
+		{ "default", "tile-16", false },
+		{ "default", "tile-64", false },
+		{ "static-tiles", "default", true },
+		{ "no-gbuffer", "default", true },
+		{ "default", "radiance-cache", false },
+		{ "row-major", "default", true },
+	};
+}
+
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t b = 0; b < size; ++b) {
+		hash ^= bytes[b];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+template <typename T>
+static uint64_t HashVector(uint64_t hash, const std::vector<T>& values) {
+	size_t count = values.size();
+	hash = HashBytes(hash, &count, sizeof(count));
+	return HashBytes(hash, values.data(), values.size() * sizeof(T));
+}
+
+// FNV-1a over everything that decides the converged image, so a cached reference is only
+// reused for the same scene, camera and tracer. Instances are hashed field by field because
+// their padding is not guaranteed to be zero.
+static uint64_t HashScene(const World& world) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+
+	int32_t version = PATH_TRACER_VERSION;
+	hash = HashBytes(hash, &version, sizeof(version));
+	hash = HashBytes(hash, &world.GetViewpoint(), sizeof(Viewpoint));
+
+	hash = HashVector(hash, world.GetPlanes());
+	hash = HashVector(hash, world.GetCuboids());
+	hash = HashVector(hash, world.GetCuboidLights());
+	hash = HashVector(hash, world.GetSpheres());
+
+	for (const Prototype& prototype : world.GetPrototypes()) {
+		hash = HashVector(hash, prototype.m_cuboids);
+		hash = HashVector(hash, prototype.m_spheres);
+	}
+
+	for (const Instance& instance : world.GetInstances()) {
+		uint64_t prototype = instance.m_prototype;
+		uint8_t overrideMaterial = instance.m_overrideMaterial;
+		hash = HashBytes(hash, &prototype, sizeof(prototype));
+		hash = HashBytes(hash, &instance.m_transform.m_translation, sizeof(Vector));
+		hash = HashBytes(hash, &instance.m_transform.m_scale, sizeof(Vector));
+		hash = HashBytes(hash, &instance.m_transform.m_rotation, sizeof(Vector));
+		hash = HashBytes(hash, &overrideMaterial, sizeof(overrideMaterial));
+		hash = HashBytes(hash, &instance.m_material, sizeof(Material));
+	}
+
+	return hash;
+}
+
+static std::string GetReferencePath(const BenchmarkSettings& settings, const BenchmarkScene& scene, uint64_t sceneHash) {
+	char hash[17];
+	snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(sceneHash));
+
+	return settings.m_cacheDir + "/" + scene.m_name + "_" + std::to_string(WINDOW_W) + "x" + std::to_string(WINDOW_H)
+		+ "_" + std::to_string(settings.m_referenceSpp) + "spp_" + hash + ".ref";
+}
+
+static bool LoadReference(const std::string& path, uint64_t sceneHash, std::vector<float>& reference) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) return false;
+
+	char magic[sizeof(REFERENCE_MAGIC)];
+	int32_t width;
+	int32_t height;
+	uint64_t hash;
+	file.read(magic, sizeof(magic));
+	file.read(reinterpret_cast<char*>(&width), sizeof(width));
+	file.read(reinterpret_cast<char*>(&height), sizeof(height));
+	file.read(reinterpret_cast<char*>(&hash), sizeof(hash));
+
+	if (!file || memcmp(magic, REFERENCE_MAGIC, sizeof(magic)) != 0 || width != WINDOW_W || height != WINDOW_H || hash != sceneHash) {
+		std::cerr << "Ignoring stale reference " << path << ".\n";
+		return false;
+	}
+
+	reference.resize(NUM_PIXELS * 3);
+	file.read(reinterpret_cast<char*>(reference.data()), reference.size() * sizeof(float));
+	return static_cast<bool>(file);
+}
+
+static void SaveReference(const std::string& path, uint64_t sceneHash, const std::vector<float>& reference) {
+	std::ofstream file(path, std::ios::binary);
+	int32_t width = WINDOW_W;
+	int32_t height = WINDOW_H;
+	file.write(REFERENCE_MAGIC, sizeof(REFERENCE_MAGIC));
+	file.write(reinterpret_cast<const char*>(&width), sizeof(width));
+	file.write(reinterpret_cast<const char*>(&height), sizeof(height));
+	file.write(reinterpret_cast<const char*>(&sceneHash), sizeof(sceneHash));
+	file.write(reinterpret_cast<const char*>(reference.data()), reference.size() * sizeof(float));
+
+	if (!file) std::cerr << "Failed to write reference " << path << ".\n";
+}
+
+static std::vector<float> GetReference(const BenchmarkSettings& settings, const BenchmarkScene& scene) {
+	World world;
+	world.SetViewpoint(scene.m_viewpoint);
+	world.SetViewChanged(false);
+
+	uint64_t sceneHash = HashScene(world);
+	std::vector<float> reference;
+	std::string path = GetReferencePath(settings, scene, sceneHash);
+
+	if (LoadReference(path, sceneHash, reference)) {
+		std::cout << "Using cached reference " << path << "\n";
+		return reference;
+	}
+
+	std::cout << "Rendering " << settings.m_referenceSpp << " spp reference for '" << scene.m_name << "'...\n";
+
+	CpuExecutor executor(world);
+	std::vector<uint32_t> pixels(NUM_PIXELS);
+
+	for (size_t s = 0; s < settings.m_referenceSpp; ++s) {
+		executor.TraceRays(pixels.data());
+		if ((s + 1) % 64 == 0) std::cout << "  " << (s + 1) << "/" << settings.m_referenceSpp << " spp\n";
+	}
+
+	const Colour* accumulator = executor.GetAccumulator();
+	const PixelLayout& layout = executor.GetLayout();
+	float count = static_cast<float>(executor.GetAccumulationCount());
+
+	// The reference is stored row-major whatever the executor's layout
+	reference.resize(NUM_PIXELS * 3);
+	for (int y = 0; y < WINDOW_H; ++y) {
+		for (int x = 0; x < WINDOW_W; ++x) {
+			const Colour& colour = accumulator[layout.GetIndex(x, y)];
+			size_t i = static_cast<size_t>(y) * WINDOW_W + x;
+			reference[i * 3 + 0] = colour.m_red / count;
+			reference[i * 3 + 1] = colour.m_green / count;
+			reference[i * 3 + 2] = colour.m_blue / count;
+		}
+	}
+
+	std::filesystem::create_directories(settings.m_cacheDir);
+	SaveReference(path, sceneHash, reference);
+
+	return reference;
+}
+
+static ErrorSample MeasureError(const CpuExecutor& executor, const std::vector<float>& reference, double seconds) {
+	const Colour* accumulator = executor.GetAccumulator();
+	const PixelLayout& layout = executor.GetLayout();
+	double count = static_cast<double>(executor.GetAccumulationCount());
+
+	double squaredError = 0.0;
+	double relativeError = 0.0;
+
+	for (int y = 0; y < WINDOW_H; ++y) {
+		for (int x = 0; x < WINDOW_W; ++x) {
+			const Colour& colour = accumulator[layout.GetIndex(x, y)];
+			const float estimate[3] = { colour.m_red, colour.m_green, colour.m_blue };
+			size_t i = static_cast<size_t>(y) * WINDOW_W + x;
+			for (int c = 0; c < 3; ++c) {
+				double ref = reference[i * 3 + c];
+				double diff = estimate[c] / count - ref;
+				squaredError += diff * diff;
+				relativeError += (diff * diff) / (ref * ref + REL_MSE_EPSILON);
+			}
+		}
+	}
+
+	double samples = NUM_PIXELS * 3.0;
+	return ErrorSample{ seconds, executor.GetAccumulationCount(), std::sqrt(squaredError / samples), relativeError / samples };
+}
+
+// Error at a given time. Between measurements MSE falls roughly as 1/time, so it is
+// interpolated linearly in log-log space rather than held at the last measurement.
+static double RmseAt(const std::vector<ErrorSample>& curve, double seconds) {
+	if (seconds <= curve.front().m_seconds) return curve.front().m_rmse;
+
+	for (size_t s = 1; s < curve.size(); ++s) {
+		const ErrorSample& before = curve[s - 1];
+		const ErrorSample& after = curve[s];
+		if (after.m_seconds < seconds) continue;
+
+		if (before.m_rmse <= 0.0 || after.m_rmse <= 0.0) return after.m_rmse;
+
+		double f = std::log(seconds / before.m_seconds) / std::log(after.m_seconds / before.m_seconds);
+		return std::exp(std::log(before.m_rmse) + f * (std::log(after.m_rmse) - std::log(before.m_rmse)));
+	}
+
+	return curve.back().m_rmse;
+}
+
+// Resolution of a single run's error at a given time: RMSE falls as 1/sqrt(time), so one
+// pass more or less moves it by about half the pass's share of the elapsed time.
+static double RmseResolutionAt(const std::vector<ErrorSample>& curve, double seconds) {
+	double passSeconds = curve.back().m_seconds / curve.back().m_spp;
+	return RmseAt(curve, seconds) * 0.5 * passSeconds / std::max(seconds, passSeconds);
+}
+
+// Brings the CPU up to clock and the caches and allocator to a steady state before the
+// first measured run, which would otherwise be penalised
+static void WarmUp(const BenchmarkSettings& settings, const BenchmarkScene& scene) {
+	World world;
+	world.SetViewpoint(scene.m_viewpoint);
+	world.SetViewChanged(false);
+	CpuExecutor executor(world);
+	std::vector<uint32_t> pixels(NUM_PIXELS);
+
+	auto start = std::chrono::steady_clock::now();
+	while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < settings.m_warmup) {
+		executor.TraceRays(pixels.data());
+	}
+}
+
+static RunResult RunConfig(const BenchmarkSettings& settings, const BenchmarkScene& scene, const BenchmarkConfig& config,
+	size_t repeat, const std::vector<float>& reference) {
+	World world;
+	world.SetViewpoint(scene.m_viewpoint);
+	world.SetViewChanged(false);
+	HardwareCounters counters;
+	CpuExecutor executor(world, config.m_options);
+	std::vector<uint32_t> pixels(NUM_PIXELS);
+
+	RunResult result{ scene.m_name, config.m_name, repeat, {}, -1.0, HardwareCounts{} };
+
+	// Only time spent tracing counts towards the budget; measuring error does not.
+	// Every pass is measured, and there is always at least one.
+	double traced = 0.0;
+	do {
+		auto start = std::chrono::steady_clock::now();
+		counters.Start();
+		executor.TraceRays(pixels.data());
+		counters.Stop();
+		traced += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		ErrorSample sample = MeasureError(executor, reference, traced);
+		result.m_curve.push_back(sample);
+
+		if (result.m_timeToThreshold < 0.0 && sample.m_rmse <= settings.m_rmseThreshold) {
+			result.m_timeToThreshold = sample.m_seconds;
+		}
+	} while (traced < settings.m_timeBudget);
+
+	result.m_counts = counters.Read();
+
+	// The heatmap only needs the CPU executor, so this works whatever GPU_BUILD is set to
+	if (!settings.m_heatmapDir.empty() && repeat == 0) {
+		std::string path = settings.m_heatmapDir + "/" + scene.m_name + "_" + config.m_name + "_cost.ppm";
+		std::error_code error;
+		std::filesystem::create_directories(settings.m_heatmapDir, error);
+		if (!executor.DumpCostHeatmap(path)) std::cerr << "Failed to write cost heatmap " << path << ".\n";
+	}
+
+	std::cout << "  " << config.m_name << " #" << (repeat + 1) << ": " << result.m_curve.back().m_spp << " spp, rmse "
+		<< result.m_curve.back().m_rmse << ", time to " << settings.m_rmseThreshold << ": ";
+	if (result.m_timeToThreshold < 0.0) std::cout << "not reached";
+	else std::cout << result.m_timeToThreshold << "s";
+	double samples = static_cast<double>(result.m_curve.back().m_spp) * NUM_PIXELS;
+	if (result.m_counts.m_cacheMisses >= 0) std::cout << ", " << result.m_counts.m_cacheMisses / samples << " cache misses per sample";
+	if (result.m_counts.m_cycles >= 0) std::cout << ", " << result.m_counts.m_cycles / samples << " cycles per sample";
+	std::cout << "\n";
+
+	return result;
+}
+
+// Mean equal-time error over the repeats of one config, and its standard error. Each run
+// contributes both the scatter between runs and its own resolution.
+static void SummariseRuns(const std::vector<const RunResult*>& runs, double seconds, double& mean, double& standardError) {
+	double n = static_cast<double>(runs.size());
+
+	mean = 0.0;
+	double resolution = 0.0;
+	for (const RunResult* run : runs) {
+		mean += RmseAt(run->m_curve, seconds);
+		double r = RmseResolutionAt(run->m_curve, seconds);
+		resolution += r * r;
+	}
+	mean /= n;
+	resolution /= n;
+
+	double variance = 0.0;
+	if (runs.size() > 1) {
+		for (const RunResult* run : runs) {
+			double diff = RmseAt(run->m_curve, seconds) - mean;
+			variance += diff * diff;
+		}
+		variance /= n - 1.0;
+	}
+
+	standardError = std::sqrt((variance + resolution) / n);
+}
+
+static double MeanSppPerSecond(const std::vector<const RunResult*>& runs) {
+	double sppPerSecond = 0.0;
+	for (const RunResult* run : runs) sppPerSecond += run->m_curve.back().m_spp / run->m_curve.back().m_seconds;
+	return sppPerSecond / runs.size();
+}
+
+static ComparisonResult Compare(const std::string& scene, const BenchmarkComparison& comparison,
+	const std::vector<const RunResult*>& baselineRuns, const std::vector<const RunResult*>& candidateRuns) {
+	// Equal time is the shortest run on either side, so no run is extrapolated
+	double seconds = baselineRuns.front()->m_curve.back().m_seconds;
+	for (const RunResult* run : baselineRuns) seconds = std::min(seconds, run->m_curve.back().m_seconds);
+	for (const RunResult* run : candidateRuns) seconds = std::min(seconds, run->m_curve.back().m_seconds);
+
+	ComparisonResult result{ scene, comparison.m_baseline, comparison.m_candidate, comparison.m_gated, seconds, 0.0, 0.0, 0.0,
+		MeanSppPerSecond(baselineRuns), MeanSppPerSecond(candidateRuns), true };
+
+	double baselineError;
+	double candidateError;
+	SummariseRuns(baselineRuns, seconds, result.m_baselineRmse, baselineError);
+	SummariseRuns(candidateRuns, seconds, result.m_candidateRmse, candidateError);
+
+	result.m_margin = REGRESSION_Z_SCORE * std::sqrt(baselineError * baselineError + candidateError * candidateError);
+	result.m_passed = result.m_candidateRmse - result.m_baselineRmse <= result.m_margin;
+
+	return result;
+}
+
+// Writes "<name>" and "<name>_per_sample" run fields, as null if the counter was unavailable
+static void WriteCount(std::ofstream& file, const std::string& name, int64_t count, double samples) {
+	file << "      \"" << name << "\": ";
+	if (count < 0) file << "null";
+	else file << count;
+	file << ",\n";
+	file << "      \"" << name << "_per_sample\": ";
+	if (count < 0) file << "null";
+	else file << count / samples;
+	file << ",\n";
+}
+
+static void WriteReport(const BenchmarkSettings& settings, const std::vector<RunResult>& runs, const std::vector<ComparisonResult>& comparisons) {
+	std::ofstream file(settings.m_reportPath);
+	if (!file) {
+		std::cerr << "Failed to write report " << settings.m_reportPath << ".\n";
+		return;
+	}
+
+	file << "{\n";
+	file << "  \"width\": " << WINDOW_W << ",\n";
+	file << "  \"height\": " << WINDOW_H << ",\n";
+	file << "  \"reference_spp\": " << settings.m_referenceSpp << ",\n";
+	file << "  \"time_budget_seconds\": " << settings.m_timeBudget << ",\n";
+	file << "  \"rmse_threshold\": " << settings.m_rmseThreshold << ",\n";
+	file << "  \"repeats\": " << settings.m_repeats << ",\n";
+	file << "  \"regression_z_score\": " << REGRESSION_Z_SCORE << ",\n";
+
+	file << "  \"comparisons\": [\n";
+	for (size_t c = 0; c < comparisons.size(); ++c) {
+		const ComparisonResult& comparison = comparisons[c];
+		file << "    { \"scene\": \"" << comparison.m_scene << "\", \"baseline\": \"" << comparison.m_baseline
+			<< "\", \"candidate\": \"" << comparison.m_candidate << "\", \"gated\": " << (comparison.m_gated ? "true" : "false")
+			<< ", \"equal_time_seconds\": " << comparison.m_seconds << ", \"baseline_rmse\": " << comparison.m_baselineRmse
+			<< ", \"candidate_rmse\": " << comparison.m_candidateRmse << ", \"margin\": " << comparison.m_margin
+			<< ", \"baseline_spp_per_second\": " << comparison.m_baselineSppPerSecond
+			<< ", \"candidate_spp_per_second\": " << comparison.m_candidateSppPerSecond
+			<< ", \"passed\": " << (comparison.m_passed ? "true" : "false") << " }"
+			<< ((c + 1 < comparisons.size()) ? ",\n" : "\n");
+	}
+	file << "  ],\n";
+
+	file << "  \"runs\": [\n";
+	for (size_t r = 0; r < runs.size(); ++r) {
+		const RunResult& run = runs[r];
+		file << "    {\n";
+		file << "      \"scene\": \"" << run.m_scene << "\",\n";
+		file << "      \"config\": \"" << run.m_config << "\",\n";
+		file << "      \"repeat\": " << run.m_repeat << ",\n";
+		file << "      \"time_to_threshold_seconds\": ";
+		if (run.m_timeToThreshold < 0.0) file << "null";
+		else file << run.m_timeToThreshold;
+		file << ",\n";
+		double samples = static_cast<double>(run.m_curve.back().m_spp) * NUM_PIXELS;
+		WriteCount(file, "cache_misses", run.m_counts.m_cacheMisses, samples);
+		WriteCount(file, "cycles", run.m_counts.m_cycles, samples);
+		WriteCount(file, "instructions", run.m_counts.m_instructions, samples);
+		file << "      \"curve\": [\n";
+		for (size_t s = 0; s < run.m_curve.size(); ++s) {
+			const ErrorSample& sample = run.m_curve[s];
+			file << "        { \"seconds\": " << sample.m_seconds << ", \"spp\": " << sample.m_spp
+				<< ", \"rmse\": " << sample.m_rmse << ", \"rel_mse\": " << sample.m_relMse << " }"
+				<< ((s + 1 < run.m_curve.size()) ? ",\n" : "\n");
+		}
+		file << "      ]\n";
+		file << "    }" << ((r + 1 < runs.size()) ? ",\n" : "\n");
+	}
+	file << "  ]\n";
+	file << "}\n";
+}
+
+// Both parsers take the whole value or nothing, so "5s" or "1x" are rejected rather than truncated.
+// Counts must start with a digit since std::stoul would wrap a leading minus sign.
+static bool ParseCount(const std::string& value, size_t& count) {
+	if (value.empty() || !isdigit(static_cast<unsigned char>(value[0]))) return false;
+
+	size_t end = 0;
+	count = std::stoul(value, &end);
+	return end == value.size();
+}
+
+static bool ParseNumber(const std::string& value, double& number) {
+	size_t end = 0;
+	number = std::stod(value, &end);
+	return end == value.size() && std::isfinite(number);
+}
+
+static bool ParseArguments(int argc, char** argv, BenchmarkSettings& settings) {
+	for (int a = 1; a < argc; ++a) {
+		std::string arg = argv[a];
+		if (a + 1 >= argc) {
+			std::cerr << "Missing value for " << arg << "\n";
+			return false;
+		}
+
+		std::string value = argv[++a];
+		bool valid = true;
+		try {
+			if (arg == "--cache-dir") settings.m_cacheDir = value;
+			else if (arg == "--report") settings.m_reportPath = value;
+			else if (arg == "--reference-spp") valid = ParseCount(value, settings.m_referenceSpp);
+			else if (arg == "--time-budget") valid = ParseNumber(value, settings.m_timeBudget);
+			else if (arg == "--threshold") valid = ParseNumber(value, settings.m_rmseThreshold);
+			else if (arg == "--repeats") valid = ParseCount(value, settings.m_repeats);
+			else if (arg == "--warmup") valid = ParseNumber(value, settings.m_warmup);
+			else if (arg == "--heatmap-dir") settings.m_heatmapDir = value;
+			else {
+				std::cerr << "Unknown argument " << arg << "\n";
+				return false;
+			}
+		} catch (const std::exception&) {
+			valid = false;
+		}
+
+		if (!valid) {
+			std::cerr << "Invalid value " << value << " for " << arg << "\n";
+			return false;
+		}
+	}
+
+	if (settings.m_referenceSpp < 1 || !(settings.m_timeBudget > 0.0) || !(settings.m_rmseThreshold > 0.0)
+		|| settings.m_repeats < 1 || !(settings.m_warmup >= 0.0)) {
+		std::cerr << "The reference spp, time budget, threshold and repeats must be positive, and the warm-up not negative\n";
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	BenchmarkSettings settings;
+	if (!ParseArguments(argc, argv, settings)) {
+		std::cerr << "Usage: " << argv[0] << " [--cache-dir dir] [--report file] [--reference-spp n]"
+			<< " [--time-budget seconds] [--threshold rmse] [--repeats n] [--warmup seconds]"
+			<< " [--heatmap-dir dir]\n";
+		return 2;
+	}
+
+	std::vector<BenchmarkConfig> configs = GetConfigs();
+	std::vector<BenchmarkComparison> comparisons = GetComparisons();
+	std::vector<RunResult> runs;
+	std::vector<ComparisonResult> comparisonResults;
+	bool passed = true;
+
+	for (const BenchmarkScene& scene : GetScenes()) {
+		std::vector<float> reference = GetReference(settings, scene);
+
+		std::cout << "Scene '" << scene.m_name << "'\n";
+
+		WarmUp(settings, scene);
+
+		// Rotate the starting config on every repeat so each one takes a turn at every position
+		size_t firstRun = runs.size();
+		for (size_t repeat = 0; repeat < settings.m_repeats; ++repeat) {
+			for (size_t c = 0; c < configs.size(); ++c) {
+				const BenchmarkConfig& config = configs[(c + repeat) % configs.size()];
+				runs.push_back(RunConfig(settings, scene, config, repeat, reference));
+			}
+		}
+
+		auto runsOf = [&](const std::string& config) {
+			std::vector<const RunResult*> configRuns;
+			for (size_t r = firstRun; r < runs.size(); ++r) {
+				if (runs[r].m_config == config) configRuns.push_back(&runs[r]);
+			}
+			return configRuns;
+		};
+
+		for (const BenchmarkComparison& comparison : comparisons) {
+			ComparisonResult result = Compare(scene.m_name, comparison, runsOf(comparison.m_baseline), runsOf(comparison.m_candidate));
+
+			std::cout << "  " << (result.m_passed ? "pass" : (result.m_gated ? "FAIL" : "worse")) << " "
+				<< result.m_candidate << " vs " << result.m_baseline << ": rmse " << result.m_candidateRmse
+				<< " vs " << result.m_baselineRmse << " at " << result.m_seconds << "s (margin " << result.m_margin << "), "
+				<< result.m_candidateSppPerSecond << " vs " << result.m_baselineSppPerSecond << " spp/s"
+				<< (result.m_gated ? "" : ", informational") << "\n";
+
+			if (result.m_gated && !result.m_passed) passed = false;
+			comparisonResults.push_back(result);
+		}
+	}
+
+	WriteReport(settings, runs, comparisonResults);
+	std::cout << "Report written to " << settings.m_reportPath << "\n";
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+// Drives RenderService headless through rejection, priority and cancellation, and exits
+// non-zero if any of them misbehaves.
+//
+// Priority: a long background job is submitted first and an interactive preview of the
+// same scene after it; the preview must finish first. Cancellation: a job is cancelled
+// part-way through a pass, and its image must be as bright on average as an uncancelled
+// render, since tiles traced in the abandoned pass hold one sample more than the rest.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+#include "Core/Vector.h"
+#include "Core/Viewpoint.h"
+#include "Model/RenderService.h"
+#include "Model/World.h"
+
+#define EXAMPLE_WIDTH 256
+#define EXAMPLE_HEIGHT 192
+#define EXAMPLE_THREADS 2
+#define REFERENCE_SPP 8
+#define BACKGROUND_SPP 4096
+#define BRIGHTNESS_TOLERANCE 0.2
+
+static bool Check(bool condition, const char* what) {
+	std::cout << (condition ? "  ok:   " : "  FAIL: ") << what << "\n";
+	return condition;
+}
+
+static double MeanRadiance(const RenderResult& result) {
+	double sum = 0.0;
+	for (const Colour& c : result.m_radiance) sum += c.m_red + c.m_green + c.m_blue;
+	return sum / (3.0 * result.m_radiance.size());
+}
+
+static RenderJob MakeJob(const std::shared_ptr<const World>& scene, size_t spp, int priority) {
+	RenderJob job{};
+	job.m_scene = scene;
+	job.m_viewpoint = Viewpoint{ Vector{ 0.3f, 0.25f, -0.5f }, Vector{ -0.5f, -0.3f, 0.0f } };
+	job.m_width = EXAMPLE_WIDTH;
+	job.m_height = EXAMPLE_HEIGHT;
+	job.m_samplesPerPixel = spp;
+	job.m_priority = priority;
+	return job;
+}
+
+static bool RunRejection(RenderService& service, const std::shared_ptr<const World>& scene) {
+	std::cout << "rejection\n";
+
+	RenderJob noScene = MakeJob(nullptr, 1, RENDER_PRIORITY_INTERACTIVE);
+	RenderJob noPixels = MakeJob(scene, 1, RENDER_PRIORITY_INTERACTIVE);
+	noPixels.m_width = 0;
+	noPixels.m_height = 0;
+
+	RenderResult a = service.Submit(std::move(noScene)).m_result.get();
+	RenderResult b = service.Submit(std::move(noPixels)).m_result.get();
+
+	bool ok = Check(a.m_rejected && a.m_pixels.empty(), "a job without a scene is rejected");
+	ok &= Check(b.m_rejected && b.m_pixels.empty(), "a job without pixels is rejected");
+	return ok;
+}
+
+static bool RunPriority(RenderService& service, const std::shared_ptr<const World>& scene) {
+	std::cout << "priority\n";
+
+	std::atomic<int> finished{0};
+	std::atomic<int> backgroundOrder{0};
+	std::atomic<int> interactiveOrder{0};
+
+	RenderJob background = MakeJob(scene, BACKGROUND_SPP, RENDER_PRIORITY_BACKGROUND);
+	background.m_onComplete = [&](const RenderResult&) { backgroundOrder = ++finished; };
+	RenderJob interactive = MakeJob(scene, 1, RENDER_PRIORITY_INTERACTIVE);
+	interactive.m_onComplete = [&](const RenderResult&) { interactiveOrder = ++finished; };
+
+	RenderTicket backgroundTicket = service.Submit(std::move(background));
+	RenderTicket interactiveTicket = service.Submit(std::move(interactive));
+
+	RenderResult preview = interactiveTicket.m_result.get();
+	service.Cancel(backgroundTicket.m_jobId);
+	RenderResult rest = backgroundTicket.m_result.get();
+
+	bool ok = Check(preview.m_samples == 1 && !preview.m_cancelled, "the interactive job completes its pass");
+	ok &= Check(interactiveOrder == 1 && backgroundOrder == 2, "the interactive job finishes before the background job");
+	ok &= Check(rest.m_cancelled, "the background job reports that it was cancelled");
+	return ok;
+}
+
+static bool RunCancel(RenderService& service, const std::shared_ptr<const World>& scene) {
+	std::cout << "cancel\n";
+
+	RenderResult reference = service.Submit(MakeJob(scene, REFERENCE_SPP, RENDER_PRIORITY_BACKGROUND)).m_result.get();
+
+	std::atomic<size_t> passes{0};
+	RenderJob job = MakeJob(scene, BACKGROUND_SPP, RENDER_PRIORITY_BACKGROUND);
+	job.m_onProgress = [&](const RenderProgress& progress) { passes = progress.m_samplesCompleted; };
+
+	RenderTicket ticket = service.Submit(std::move(job));
+	// The next pass is queued as soon as the first completes, so this lands inside it
+	while (passes == 0) std::this_thread::yield();
+	std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	bool cancelled = service.Cancel(ticket.m_jobId);
+	RenderResult result = ticket.m_result.get();
+
+	double expected = MeanRadiance(reference);
+	double actual = MeanRadiance(result);
+	std::cout << "  cancelled after " << result.m_samples << " spp, mean radiance " << actual
+		<< " against " << expected << " at " << reference.m_samples << " spp\n";
+
+	bool ok = Check(cancelled && result.m_cancelled, "the job reports that it was cancelled");
+	ok &= Check(result.m_samples >= 1 && result.m_samples < BACKGROUND_SPP, "the job stops early with its completed passes");
+	ok &= Check(std::abs(actual - expected) <= BRIGHTNESS_TOLERANCE * expected, "the cancelled image is as bright as a finished one");
+	return ok;
+}
+
+int main() {
+	auto scene = std::make_shared<const World>();
+	RenderService service(EXAMPLE_THREADS);
+
+	bool ok = RunRejection(service, scene);
+	ok &= RunPriority(service, scene);
+	ok &= RunCancel(service, scene);
+
+	std::cout << (ok ? "all checks passed" : "some checks failed") << "\n";
+	return ok ? 0 : 1;
+}
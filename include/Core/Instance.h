@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Core/Cuboid.h"
+#include "Core/Material.h"
+#include "Core/Sphere.h"
+#include "Core/Vector.h"
+
+// A group of primitives in its own local space, defined once and placed many times.
+struct Prototype {
+	std::vector<Cuboid>	m_cuboids;
+	std::vector<Sphere>	m_spheres;
+};
+
+// Scale is applied first, then rotation, then translation. Every scale component must be non-zero.
+struct Transform {
+	Vector	m_translation	= Vector{ 0.0f, 0.0f, 0.0f };
+	Vector	m_scale			= Vector{ 1.0f, 1.0f, 1.0f };
+	Vector	m_rotation		= Vector{ 0.0f, 0.0f, 0.0f };	// yaw, pitch, roll in radians
+};
+
+struct Instance {
+	size_t		m_prototype;
+	Transform	m_transform;
+	bool		m_overrideMaterial	= false;
+	Material	m_material			= Material{};
+};
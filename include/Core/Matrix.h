@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cmath>
+
+#include "Core/Vector.h"
+
+struct Matrix3 {
+	Vector m_row0;
+	Vector m_row1;
+	Vector m_row2;
+};
+
+inline Vector operator*(const Matrix3& m, const Vector& v) {
+	return Vector{ Dot(m.m_row0, v), Dot(m.m_row1, v), Dot(m.m_row2, v) };
+}
+
+inline Matrix3 operator*(const Matrix3& a, const Matrix3& b) {
+	Vector col0{ b.m_row0.m_x, b.m_row1.m_x, b.m_row2.m_x };
+	Vector col1{ b.m_row0.m_y, b.m_row1.m_y, b.m_row2.m_y };
+	Vector col2{ b.m_row0.m_z, b.m_row1.m_z, b.m_row2.m_z };
+
+	return Matrix3{
+		Vector{ Dot(a.m_row0, col0), Dot(a.m_row0, col1), Dot(a.m_row0, col2) },
+		Vector{ Dot(a.m_row1, col0), Dot(a.m_row1, col1), Dot(a.m_row1, col2) },
+		Vector{ Dot(a.m_row2, col0), Dot(a.m_row2, col1), Dot(a.m_row2, col2) }
+	};
+}
+
+inline Matrix3 Transpose(const Matrix3& m) {
+	return Matrix3{
+		Vector{ m.m_row0.m_x, m.m_row1.m_x, m.m_row2.m_x },
+		Vector{ m.m_row0.m_y, m.m_row1.m_y, m.m_row2.m_y },
+		Vector{ m.m_row0.m_z, m.m_row1.m_z, m.m_row2.m_z }
+	};
+}
+
+inline Matrix3 Scale(const Vector& s) {
+	return Matrix3{ Vector{ s.m_x, 0.0f, 0.0f }, Vector{ 0.0f, s.m_y, 0.0f }, Vector{ 0.0f, 0.0f, s.m_z } };
+}
+
+// Yaw about Y, then pitch about X, then roll about Z; yaw and pitch match Viewpoint::m_direction.
+inline Matrix3 Rotation(const Vector& euler) {
+	float cy = cos(euler.m_x), sy = sin(euler.m_x);
+	float cp = cos(euler.m_y), sp = sin(euler.m_y);
+	float cr = cos(euler.m_z), sr = sin(euler.m_z);
+
+	Matrix3 yaw{ Vector{ cy, 0.0f, sy }, Vector{ 0.0f, 1.0f, 0.0f }, Vector{ -sy, 0.0f, cy } };
+	Matrix3 pitch{ Vector{ 1.0f, 0.0f, 0.0f }, Vector{ 0.0f, cp, -sp }, Vector{ 0.0f, sp, cp } };
+	Matrix3 roll{ Vector{ cr, -sr, 0.0f }, Vector{ sr, cr, 0.0f }, Vector{ 0.0f, 0.0f, 1.0f } };
+
+	return roll * pitch * yaw;
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cmath>
+
 struct Vector {
 	float m_x;
 	float m_y;
@@ -33,4 +35,15 @@ inline float Dot(const Vector& v1, const Vector& v2) {
 
 inline Vector Reflect(const Vector& v, const Vector& n) {
 	return v - 2.0f * Dot(v, n) * n;
-}
\ No newline at end of file
+}
+inline float Length(const Vector& v) {
+	return sqrt(Dot(v, v));
+}
+
+inline Vector Min(const Vector& v1, const Vector& v2) {
+	return Vector{ (v1.m_x < v2.m_x) ? v1.m_x : v2.m_x, (v1.m_y < v2.m_y) ? v1.m_y : v2.m_y, (v1.m_z < v2.m_z) ? v1.m_z : v2.m_z };
+}
+
+inline Vector Max(const Vector& v1, const Vector& v2) {
+	return Vector{ (v1.m_x > v2.m_x) ? v1.m_x : v2.m_x, (v1.m_y > v2.m_y) ? v1.m_y : v2.m_y, (v1.m_z > v2.m_z) ? v1.m_z : v2.m_z };
+}
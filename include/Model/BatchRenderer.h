@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <semaphore>
+#include <string>
+#include <vector>
+
+#include "Core/Colour.h"
+#include "Core/Viewpoint.h"
+#include "Model/PathTracer.h"
+#include "Model/Tile.h"
+#include "Model/WorkerPool.h"
+#include "Model/World.h"
+
+// Frames whose tiles may be queued at once. Keeps the pool fed across frame
+// boundaries without holding an accumulator for every frame of a long sequence.
+#define BATCH_FRAMES_IN_FLIGHT 3
+
+
+struct BatchStatistics {
+	size_t	m_frames;
+	double	m_seconds;
+	double	m_framesPerHour;
+	size_t	m_failedWrites;		// frames rendered but not saved; every frame if the prefix is unwritable
+};
+
+// Renders a sequence of viewpoints of one world into numbered PPM files
+// ("<prefix>_00000.ppm", ...). All frames share the world and the worker pool.
+// Nothing is rendered unless the first frame's file can be created.
+class BatchRenderer {
+public:
+	BatchRenderer(const World& world, WorkerPool& pool);
+
+	BatchStatistics Render(const std::vector<Viewpoint>& viewpoints, size_t samplesPerFrame, const std::string& outputPrefix);
+
+private:
+	struct FrameJob {
+		size_t				m_index;
+		Viewpoint			m_viewpoint;
+		std::vector<Colour>	m_accumulator;
+		std::atomic<size_t>	m_remainingTiles;
+	};
+
+	static std::string GetFramePath(const std::string& outputPrefix, size_t index);
+
+	void TraceTile(FrameJob& frame, const Tile& tile, size_t samplesPerFrame);
+	bool FinishFrame(FrameJob& frame, const std::string& outputPrefix);
+
+	PathTracer						m_tracer;
+	WorkerPool&						m_pool;
+	std::vector<Tile>				m_tiles;
+	std::counting_semaphore<BATCH_FRAMES_IN_FLIGHT>	m_framesInFlight;
+};
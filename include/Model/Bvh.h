@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Core/Ray.h"
+#include "Core/Vector.h"
+
+#define BVH_LEAF_SIZE 4
+#define BVH_STACK_SIZE 64
+
+
+struct Bounds {
+	Vector m_min;
+	Vector m_max;
+};
+
+inline Bounds Union(const Bounds& b1, const Bounds& b2) {
+	return Bounds{ Min(b1.m_min, b2.m_min), Max(b1.m_max, b2.m_max) };
+}
+
+struct BvhNode {
+	Bounds		m_bounds;
+	uint32_t	m_start;	// first primitive (leaf) or right child (interior); left child is always the next node
+	uint32_t	m_count;	// zero for interior nodes
+};
+
+// Bounding volume hierarchy over opaque primitives identified by index. Used both as
+// the top level over instances and as the bottom level inside each prototype.
+class Bvh {
+public:
+	Bvh();
+
+	void Build(const std::vector<Bounds>& primitiveBounds);
+
+	inline bool IsEmpty() const { return m_nodes.empty(); }
+	inline const Bounds& GetBounds() const { return m_nodes.front().m_bounds; }
+
+	// Calls visit(primitiveIndex) for every primitive whose bounds the ray enters before tMax.
+	// tMax is re-read after each visit, so a visitor that records closer hits prunes the rest.
+	template <typename Visitor>
+	void Traverse(const Ray& ray, const float& tMax, Visitor&& visit) const;
+
+private:
+	uint32_t BuildRecursive(const std::vector<Bounds>& primitiveBounds, uint32_t start, uint32_t count);
+
+	static bool HitsBounds(const Bounds& bounds, const Vector& origin, const Vector& inverseVel, float tMax);
+
+	std::vector<BvhNode>	m_nodes;
+	std::vector<uint32_t>	m_indices;
+};
+
+inline bool Bvh::HitsBounds(const Bounds& bounds, const Vector& origin, const Vector& inverseVel, float tMax) {
+	float xT1 = (bounds.m_min.m_x - origin.m_x) * inverseVel.m_x;
+	float xT2 = (bounds.m_max.m_x - origin.m_x) * inverseVel.m_x;
+	float yT1 = (bounds.m_min.m_y - origin.m_y) * inverseVel.m_y;
+	float yT2 = (bounds.m_max.m_y - origin.m_y) * inverseVel.m_y;
+	float zT1 = (bounds.m_min.m_z - origin.m_z) * inverseVel.m_z;
+	float zT2 = (bounds.m_max.m_z - origin.m_z) * inverseVel.m_z;
+
+	float tEnter = fmax(fmax(fmin(xT1, xT2), fmin(yT1, yT2)), fmin(zT1, zT2));
+	float tExit = fmin(fmin(fmax(xT1, xT2), fmax(yT1, yT2)), fmax(zT1, zT2));
+
+	return tEnter <= tExit && tExit > 0.0f && tEnter < tMax;
+}
+
+template <typename Visitor>
+void Bvh::Traverse(const Ray& ray, const float& tMax, Visitor&& visit) const {
+	if (m_nodes.empty()) return;
+
+	Vector inverseVel{ 1.0f / ray.m_vel.m_x, 1.0f / ray.m_vel.m_y, 1.0f / ray.m_vel.m_z };
+
+	uint32_t stack[BVH_STACK_SIZE];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0) {
+		const BvhNode& node = m_nodes[stack[--top]];
+		if (!HitsBounds(node.m_bounds, ray.m_pos, inverseVel, tMax)) continue;
+
+		if (node.m_count > 0) {
+			for (uint32_t p = node.m_start; p < node.m_start + node.m_count; ++p) visit(m_indices[p]);
+			continue;
+		}
+
+		uint32_t left = static_cast<uint32_t>(&node - m_nodes.data()) + 1;
+		stack[top++] = node.m_start;
+		stack[top++] = left;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Core/Viewpoint.h"
+
+
+struct CameraKeyframe {
+	float		m_time;
+	Viewpoint	m_viewpoint;
+};
+
+// Piecewise-linear camera path. Keyframes are kept sorted by time; position and
+// yaw/pitch are interpolated independently.
+class CameraPath {
+public:
+	CameraPath();
+
+	void AddKeyframe(float time, const Viewpoint& viewpoint);
+
+	// One keyframe per line: "time px py pz yaw pitch". Blank lines and lines starting with '#' are skipped.
+	bool LoadFromFile(const std::string& path);
+
+	Viewpoint Evaluate(float time) const;
+
+	// Evenly spaced samples from the first to the last keyframe, inclusive.
+	std::vector<Viewpoint> Sample(size_t numFrames) const;
+
+	std::vector<Viewpoint> GetKeyframeViewpoints() const;
+
+	inline bool IsEmpty() const { return m_keyframes.empty(); }
+
+private:
+	std::vector<CameraKeyframe> m_keyframes;
+};
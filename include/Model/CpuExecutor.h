@@ -1,55 +1,94 @@
 #pragma once
 
 #include <cstddef>
-#include <random>
-#include <thread>
+#include <memory>
+#include <string>
+#include <vector>
 
-#include "Core/Axis.h"
-#include "Core/Collision.h"
 #include "Core/Colour.h"
-#include "Core/Cuboid.h"
-#include "Core/Material.h"
-#include "Core/Plane.h"
-#include "Core/Ray.h"
+#include "Model/PathTracer.h"
+#include "Model/PixelLayout.h"
+#include "Model/RadianceCache.h"
+#include "Model/Tile.h"
+#include "Model/WorkerPool.h"
 #include "View/Canvas.h"
 #include "World.h"
 
-#define DIFFUSE_DAMPEN_FACTOR 0.9f
-#define EPSILON 1e-4
-#define MAX_COLLISIONS 7
+// A tile whose cost per pixel last frame was this many times the frame average is split into quarters
+#define COST_SPLIT_FACTOR 2.0f
+#define MIN_TILE_SIZE 8
 
-const int NUM_THREADS = std::thread::hardware_concurrency();
-const int RAYS_PER_THREAD = NUM_PIXELS / NUM_THREADS;
+#define MAX_SUBPIXEL_SAMPLES 4
 
 
+struct CpuExecutorOptions {
+	int		m_numThreads	= NUM_THREADS;
+	int		m_tileSize		= TILE_SIZE;
+	bool	m_radianceCache	= false;	// end diffuse paths in a world-space cache kept across view changes
+	bool	m_costSchedule	= true;		// dispatch the most expensive tiles of the last frame first, split finer
+	bool	m_gBufferCache	= true;		// reuse primary hits while the camera is still
+	int		m_subpixelSamples	= 1;	// 1 traces pixel centres; up to MAX_SUBPIXEL_SAMPLES cycles fixed offsets for anti-aliasing
+	bool	m_tiledLayout	= true;		// walk tiles in Morton order and store per-pixel buffers tile by tile to match
+};
+
 class CpuExecutor {
 public:
-	CpuExecutor(const World& world);
+	CpuExecutor(const World& world, const CpuExecutorOptions& options = CpuExecutorOptions{});
 	~CpuExecutor();
 
-	void TraceRays(uint32_t* pixelBuffer);
-
-private:
 	void RefreshAccumulator();
 
-	float Rand_11();
-	float Rand01();
-
-	Vector Scatter(const Vector& normal);
+	void TraceRays(uint32_t* pixelBuffer);
 
-	bool ShouldSpectralReflect(float reflectionIndex);
+	// Per-pixel buffers are stored in this layout; index them with GetLayout().GetIndex(x, y)
+	inline const PixelLayout&	GetLayout() const { return m_layout; }
 
-	void CalculateNextRay(Ray& ray, const Collision& collision);
+	// Running sum of every pass since the last refresh; divide by the count for the estimate.
+	inline const Colour*	GetAccumulator() const { return m_accumulator; }
+	inline size_t			GetAccumulationCount() const { return m_accumulationCount; }
 
-	bool TryCollision(const Plane& plane, const Ray& ray, Collision& bestCollision);
-	bool TryCollision(const Cuboid& cuboid, const Ray& ray, Collision& bestCollision);
+	// Per-pixel cost of the latest pass
+	inline const RayCost*	GetCostBuffer() const { return m_cost.data(); }
 
-	Ray GenerateInitialRay(size_t i);
+	// While enabled, TraceRays writes the cost heatmap to the pixel buffer instead of the image
+	inline void	SetShowCost(bool showCost) { m_showCost = showCost; }
+	inline bool	IsShowingCost() const { return m_showCost; }
 
-	void TraceRay(Colour* buffer, size_t i);
-	void TraceRayRange(Colour* buffer, size_t start, size_t end);
+	void ResolveCostHeatmap(uint32_t* pixelBuffer) const;
+	bool DumpCostHeatmap(const std::string& path) const;
 
-	const World&	m_world;
-	Colour* 		m_accumulator;
-	size_t			m_accumulationCount;
-};
\ No newline at end of file
+private:
+	struct TileCost {
+		Tile		m_tile;
+		uint64_t	m_cost;
+	};
+
+	void ScheduleTiles();
+	void SplitTile(const Tile& tile, double splitCost, std::vector<TileCost>& tiles) const;
+	uint64_t GetTileCost(const Tile& tile) const;
+
+	void UpdateGBuffer(const Viewpoint& viewpoint);
+
+	void TraceTile(const Tile& tile, const Viewpoint& viewpoint, uint32_t* pixelBuffer);
+	void TracePixel(int x, int y, const Viewpoint& viewpoint, PrimaryHit* gBuffer, bool gBufferFilled, float offsetX, float offsetY);
+	void ResolveTile(const Tile& tile, uint32_t* pixelBuffer) const;
+
+	const World&					m_world;
+	PixelLayout						m_layout;
+	std::unique_ptr<RadianceCache>	m_radianceCache;
+	PathTracer						m_tracer;
+	WorkerPool						m_pool;
+	std::vector<Tile>				m_tiles;
+	std::vector<Tile>				m_schedule;
+	std::vector<RayCost>			m_cost;
+	bool							m_costSchedule;
+	bool							m_showCost;
+	bool							m_gBufferCache;
+	int								m_subpixelSamples;
+	size_t							m_passIndex;
+	std::vector<PrimaryHit>			m_gBuffer;			// one plane of hits per sub-pixel offset
+	std::vector<bool>				m_gBufferFilled;	// per sub-pixel offset
+	Viewpoint						m_gBufferViewpoint;
+	Colour* 						m_accumulator;
+	size_t							m_accumulationCount;
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Core/Axis.h"
+#include "Core/Collision.h"
+#include "Core/Colour.h"
+#include "Core/Cuboid.h"
+#include "Core/Instance.h"
+#include "Core/Material.h"
+#include "Core/Matrix.h"
+#include "Core/Plane.h"
+#include "Core/Ray.h"
+#include "Core/Sphere.h"
+#include "Core/Viewpoint.h"
+#include "View/Canvas.h"
+#include "Model/Bvh.h"
+#include "Model/RadianceCache.h"
+#include "Model/World.h"
+
+#define DIFFUSE_DAMPEN_FACTOR 0.9f
+#define EPSILON 1e-4
+#define MAX_COLLISIONS 7
+
+// Bump when a change alters the image the tracer converges to, so cached references are re-rendered
+#define PATH_TRACER_VERSION 1
+
+// Hits from this one on (0 is the primary hit) may end the path at a radiance cache entry
+#define RADIANCE_CACHE_LOOKUP_DEPTH 1
+
+// PrimaryHit::m_material of a camera ray that left the scene
+#define PRIMARY_HIT_MISS UINT32_MAX
+
+constexpr float FOV_Y = 90.0f * static_cast<float>(M_PI) / 180.0f;
+
+
+// Work done for one path, for profiling where frame time goes
+struct RayCost {
+	uint32_t	m_bounces;
+	uint32_t	m_intersectionTests;
+};
+
+// First hit of a camera ray. Camera rays are deterministic per pixel (and sub-pixel
+// offset), so this can be reused for every pass until the camera moves. Kept small as
+// the G-buffer holds one per pixel: the ray itself is regenerated when tracing on.
+struct PrimaryHit {
+	Vector		m_location;
+	Vector		m_normal;
+	uint32_t	m_material;		// index into the tracer's material table, or PRIMARY_HIT_MISS
+};
+
+// An instance with its transforms resolved for tracing
+struct PreparedInstance {
+	Matrix3		m_toLocal;			// (RS)^-1, applied after removing the translation
+	Matrix3		m_normalToWorld;	// (RS)^-T
+	Vector		m_translation;
+	uint32_t	m_prototype;
+	bool		m_overrideMaterial;
+	Material	m_material;
+};
+
+// CPU tracing core. Safe to call concurrently from many threads for the same world,
+// as long as the world is not modified while tracing. The only state written while
+// tracing is the optional radiance cache, which is itself thread-safe.
+//
+// Instances are traced through a two-level hierarchy: a top-level BVH over the world
+// bounds of every instance, and one bottom-level BVH per prototype in its local space.
+// Both are built once, when the tracer is constructed.
+class PathTracer {
+public:
+	PathTracer(const World& world);
+
+	// Pixel i of the WINDOW_W x WINDOW_H window
+	inline Colour TraceRay(const Viewpoint& viewpoint, size_t i, RayCost* cost = nullptr) const {
+		return TraceRay(viewpoint, i % WINDOW_W, i / WINDOW_W, WINDOW_W, WINDOW_H, cost);
+	}
+	Colour TraceRay(const Viewpoint& viewpoint, int x, int y, int width, int height, RayCost* cost = nullptr) const;
+
+	// Splits TraceRay in two so the first half can be cached. The offset is the ray's
+	// position within the pixel, from 0 to 1 on each axis; TraceRay uses the centre.
+	// TraceFromPrimaryHit must be given the same pixel and offset as the hit was traced for.
+	PrimaryHit TracePrimaryHit(const Viewpoint& viewpoint, int x, int y, int width, int height, float offsetX = 0.5f, float offsetY = 0.5f,
+		RayCost* cost = nullptr) const;
+	Colour TraceFromPrimaryHit(const PrimaryHit& primaryHit, const Viewpoint& viewpoint, int x, int y, int width, int height,
+		float offsetX = 0.5f, float offsetY = 0.5f, RayCost* cost = nullptr) const;
+
+	// When set, diffuse hits fill the cache and later diffuse hits end there instead of
+	// tracing on. The cache must outlive the tracer or be unset first.
+	inline void SetRadianceCache(RadianceCache* radianceCache) { m_radianceCache = radianceCache; }
+
+private:
+	static float Rand_11();
+	static float Rand01();
+
+	static Vector Scatter(const Vector& normal);
+
+	static bool ShouldSpectralReflect(float reflectionIndex);
+
+	static void CalculateNextRay(Ray& ray, const Collision& collision, bool spectral);
+
+	static bool TryCollision(const Plane& plane, const Ray& ray, Collision& bestCollision);
+	static bool TryCollision(const Cuboid& cuboid, const Ray& ray, Collision& bestCollision);
+	static bool TryCollision(const Sphere& sphere, const Ray& ray, Collision& bestCollision);
+
+	bool TryCollision(const PreparedInstance& instance, const Ray& ray, Collision& bestCollision, uint32_t& tests) const;
+	void TryInstances(const Ray& ray, Collision& bestCollision, uint32_t& tests) const;
+
+	// Returns the number of bounds and primitive tests made
+	uint32_t FindClosestCollision(const Ray& ray, Collision& bestCollision) const;
+
+	static Ray GenerateInitialRay(const Viewpoint& viewpoint, int x, int y, int width, int height, float offsetX, float offsetY);
+
+	// Follows a path from the camera; if primaryHit is given, its first intersection is taken from there
+	Colour TracePath(Ray ray, const PrimaryHit* primaryHit, RayCost* cost) const;
+
+	void BuildAccelerationStructures();
+	void BuildMaterialTable();
+	void AddMaterial(const Material& material);
+
+	// Materials compare and hash bitwise; every hit copies its material from a primitive verbatim
+	struct MaterialHash {
+		size_t operator()(const Material& material) const;
+	};
+	struct MaterialEqual {
+		bool operator()(const Material& a, const Material& b) const;
+	};
+
+	struct CacheVertex {
+		Vector	m_location;
+		Vector	m_normal;
+		Colour	m_throughput;	// path throughput arriving at the hit
+	};
+
+	void RecordCacheVertices(const CacheVertex* vertices, int numVertices, const Colour& pathColour) const;
+
+	const World&					m_world;
+	std::vector<Bvh>				m_prototypeBvhs;
+	std::vector<PreparedInstance>	m_instances;
+	Bvh								m_instanceBvh;
+	std::vector<Material>			m_materials;
+	std::unordered_map<Material, uint32_t, MaterialHash, MaterialEqual>	m_materialIndices;
+	RadianceCache*					m_radianceCache;
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Tiles of the tiled layout are 2^LAYOUT_TILE_SHIFT pixels square
+#define LAYOUT_TILE_SHIFT 5
+#define LAYOUT_TILE_SIZE (1 << LAYOUT_TILE_SHIFT)
+
+
+// Interleaves the low 16 bits of v with zeros: ...dcba -> ...0d0c0b0a
+inline uint32_t SpreadBits(uint32_t v) {
+	v &= 0x0000FFFF;
+	v = (v | (v << 8)) & 0x00FF00FF;
+	v = (v | (v << 4)) & 0x0F0F0F0F;
+	v = (v | (v << 2)) & 0x33333333;
+	v = (v | (v << 1)) & 0x55555555;
+	return v;
+}
+
+inline uint32_t CompactBits(uint32_t v) {
+	v &= 0x55555555;
+	v = (v | (v >> 1)) & 0x33333333;
+	v = (v | (v >> 2)) & 0x0F0F0F0F;
+	v = (v | (v >> 4)) & 0x00FF00FF;
+	v = (v | (v >> 8)) & 0x0000FFFF;
+	return v;
+}
+
+inline uint32_t MortonEncode(uint32_t x, uint32_t y) {
+	return SpreadBits(x) | (SpreadBits(y) << 1);
+}
+
+inline void MortonDecode(uint32_t code, uint32_t& x, uint32_t& y) {
+	x = CompactBits(code);
+	y = CompactBits(code >> 1);
+}
+
+// Maps pixel coordinates to storage indices for per-pixel buffers. Row-major is the
+// plain y * width + x. Tiled stores LAYOUT_TILE_SIZE square tiles one after another,
+// each in Z (Morton) order, so pixels that are close on screen are close in memory.
+// The tiled layout pads the image up to whole tiles, so size buffers with GetStorageSize().
+class PixelLayout {
+public:
+	PixelLayout(int width, int height, bool tiled) :
+		m_width{width},
+		m_height{height},
+		m_tilesX{ (width + LAYOUT_TILE_SIZE - 1) >> LAYOUT_TILE_SHIFT },
+		m_tilesY{ (height + LAYOUT_TILE_SIZE - 1) >> LAYOUT_TILE_SHIFT },
+		m_tiled{tiled}
+	{
+	}
+
+	inline bool IsTiled() const { return m_tiled; }
+
+	inline size_t GetStorageSize() const {
+		if (!m_tiled) return static_cast<size_t>(m_width) * m_height;
+		return static_cast<size_t>(m_tilesX) * m_tilesY * LAYOUT_TILE_SIZE * LAYOUT_TILE_SIZE;
+	}
+
+	inline size_t GetIndex(int x, int y) const {
+		if (!m_tiled) return static_cast<size_t>(y) * m_width + x;
+
+		size_t tile = static_cast<size_t>(y >> LAYOUT_TILE_SHIFT) * m_tilesX + (x >> LAYOUT_TILE_SHIFT);
+		return (tile << (2 * LAYOUT_TILE_SHIFT)) | MortonEncode(x & (LAYOUT_TILE_SIZE - 1), y & (LAYOUT_TILE_SIZE - 1));
+	}
+
+private:
+	int		m_width;
+	int		m_height;
+	int		m_tilesX;
+	int		m_tilesY;
+	bool	m_tiled;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "Core/Colour.h"
+#include "Core/Vector.h"
+
+#define RADIANCE_CACHE_CELL_SIZE 0.02f
+#define RADIANCE_CACHE_ENTRIES (1 << 20)
+#define RADIANCE_CACHE_MAX_PROBES 8
+#define RADIANCE_CACHE_MIN_SAMPLES 16	// entries are not used until they have this many samples
+#define RADIANCE_CACHE_MAX_SAMPLES 4096	// entries stop updating once they have this many
+
+
+// World-space cache of outgoing diffuse radiance, hashed on a position grid and a
+// coarsely quantised normal. Entries depend only on the scene, not the camera, so they
+// stay valid across view changes; call Clear() if the scene itself changes.
+//
+// Lock-free: any number of threads may Record and Lookup concurrently. A full
+// neighbourhood in the table simply drops the sample.
+class RadianceCache {
+public:
+	RadianceCache();
+
+	void Clear();
+
+	void Record(const Vector& location, const Vector& normal, const Colour& radiance);
+	bool Lookup(const Vector& location, const Vector& normal, Colour& radiance) const;
+
+	size_t GetNumEntries() const;
+
+private:
+	struct Entry {
+		std::atomic<uint64_t>	m_key;	// zero marks an empty slot
+		std::atomic<uint32_t>	m_count;
+		std::atomic<float>		m_red;
+		std::atomic<float>		m_green;
+		std::atomic<float>		m_blue;
+	};
+
+	static uint64_t GetKey(const Vector& location, const Vector& normal);
+
+	std::unique_ptr<Entry[]> m_entries;
+};
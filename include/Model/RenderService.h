@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Core/Colour.h"
+#include "Core/Viewpoint.h"
+#include "Model/WorkerPool.h"
+#include "Model/World.h"
+#include "View/Canvas.h"
+
+// Interactive previews outrank background stills, so their tiles are picked up
+// as soon as a worker finishes whatever tile it is on.
+#define RENDER_PRIORITY_BACKGROUND 0
+#define RENDER_PRIORITY_INTERACTIVE 100
+
+#define RENDER_JOB_TILE_SIZE 32
+
+class PathTracer;
+
+
+struct RenderProgress {
+	uint64_t	m_jobId;
+	size_t		m_samplesCompleted;
+	size_t		m_samplesTarget;	// zero if the job is bounded only by time
+	double		m_seconds;
+};
+
+struct RenderResult {
+	uint64_t				m_jobId;
+	int						m_width;
+	int						m_height;
+	size_t					m_samples;	// passes completed; tiles of a cancelled job's last pass may have one more
+	double					m_seconds;
+	bool					m_cancelled;
+	bool					m_rejected;	// the job had no scene or no pixels; nothing was traced and the buffers are empty
+	std::vector<uint32_t>	m_pixels;	// tonemapped ARGB8888, row-major
+	std::vector<Colour>		m_radiance;	// linear mean radiance, row-major
+};
+
+// A job stops after m_samplesPerPixel passes or once m_timeBudget seconds have
+// elapsed, whichever comes first. At least one of the two must be non-zero.
+// Jobs on the same scene share one tracer, whose acceleration structures are built when
+// the scene is first submitted, so a scene must not change once it has been submitted.
+struct RenderJob {
+	std::shared_ptr<const World>				m_scene;
+	Viewpoint									m_viewpoint;
+	int											m_width				= WINDOW_W;
+	int											m_height			= WINDOW_H;
+	size_t										m_samplesPerPixel	= 0;
+	double										m_timeBudget		= 0.0;
+	int											m_priority			= RENDER_PRIORITY_BACKGROUND;
+	std::function<void(const RenderProgress&)>	m_onProgress;
+	std::function<void(const RenderResult&)>	m_onComplete;
+};
+
+struct RenderTicket {
+	uint64_t					m_jobId;
+	std::future<RenderResult>	m_result;
+};
+
+// Runs render jobs for any number of scenes on one shared worker pool. Each job is
+// traced one sample per pixel at a time, split into tiles queued at the job's priority.
+// Callbacks run on a worker thread and must not block. A job that finishes without
+// tracing anything, such as a rejected one, completes on the submitting thread instead.
+class RenderService {
+public:
+	RenderService(int numThreads = NUM_THREADS);
+	~RenderService();
+
+	RenderTicket Submit(RenderJob job);
+
+	// The job finishes at the end of its current pass with m_cancelled set.
+	// Returns false if the job is unknown or already finished.
+	bool Cancel(uint64_t jobId);
+
+private:
+	struct JobState;
+
+	struct TracerEntry {
+		std::weak_ptr<const World>			m_scene;
+		std::shared_ptr<const PathTracer>	m_tracer;
+	};
+
+	std::shared_ptr<const PathTracer> GetTracer(const std::shared_ptr<const World>& scene);
+
+	void SubmitPass(const std::shared_ptr<JobState>& job);
+	void TraceTile(JobState& job, size_t tile);
+	void CompletePass(const std::shared_ptr<JobState>& job);
+	void FinishJob(const std::shared_ptr<JobState>& job);
+	RenderTicket RejectJob(RenderJob job);
+
+	std::mutex											m_mutex;
+	std::condition_variable								m_jobsFinished;
+	std::unordered_map<uint64_t, std::shared_ptr<JobState>>	m_jobs;
+	uint64_t											m_nextJobId;
+	std::mutex											m_tracerMutex;	// guards m_tracers only; tracers are built without it held
+	std::vector<TracerEntry>							m_tracers;
+	WorkerPool											m_pool;
+};
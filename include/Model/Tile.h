@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+
+#define TILE_SIZE 32
+
+
+struct Tile {
+	int m_x0;
+	int m_y0;
+	int m_x1;
+	int m_y1;
+};
+
+inline std::vector<Tile> MakeTiles(int width, int height, int tileSize) {
+	std::vector<Tile> tiles;
+	for (int y = 0; y < height; y += tileSize) {
+		for (int x = 0; x < width; x += tileSize) {
+			int x1 = (x + tileSize < width) ? x + tileSize : width;
+			int y1 = (y + tileSize < height) ? y + tileSize : height;
+			tiles.push_back(Tile{ x, y, x1, y1 });
+		}
+	}
+	return tiles;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+const int NUM_THREADS = std::thread::hardware_concurrency();
+
+
+// Fixed set of threads pulling tasks from one queue. Higher priority tasks run first;
+// tasks of equal priority run in submission order. Running tasks are never interrupted,
+// so callers that want preemption submit work in small pieces (e.g. tiles).
+class WorkerPool {
+public:
+	WorkerPool(int numThreads = NUM_THREADS);
+	~WorkerPool();
+
+	void Submit(std::function<void()> task, int priority = 0);
+
+	inline int GetNumThreads() const { return static_cast<int>(m_threads.size()); }
+
+private:
+	struct Task {
+		int						m_priority;
+		uint64_t				m_sequence;
+		std::function<void()>	m_function;
+	};
+
+	struct TaskOrder {
+		bool operator()(const Task& a, const Task& b) const {
+			if (a.m_priority != b.m_priority) return a.m_priority < b.m_priority;
+			return a.m_sequence > b.m_sequence;
+		}
+	};
+
+	void WorkerLoop();
+
+	std::vector<std::thread>								m_threads;
+	std::priority_queue<Task, std::vector<Task>, TaskOrder>	m_tasks;
+	uint64_t												m_nextSequence;
+	std::mutex												m_mutex;
+	std::condition_variable									m_condition;
+	bool													m_stopping;
+};
@@ -4,6 +4,7 @@
 #include <iostream>
 
 #include "Core/Cuboid.h"
+#include "Core/Instance.h"
 #include "Core/Plane.h"
 #include "Core/Sphere.h"
 #include "Core/Vector.h"
@@ -33,6 +34,7 @@ public:
 		m_viewChanged = true; 
 	}
 	inline void ShiftPosition(Vector direction) { m_viewpoint.m_position = m_viewpoint.m_position + direction; }
+	inline void SetViewpoint(const Viewpoint& viewpoint) { m_viewpoint = viewpoint; m_viewChanged = true; }
 	
 	inline void MoveLeft() 		{ if (m_velocity.m_x != WALK_SPEED) 	m_velocity.m_x = -WALK_SPEED; }
 	inline void MoveRight() 	{ if (m_velocity.m_x != -WALK_SPEED) 	m_velocity.m_x = WALK_SPEED; }
@@ -54,10 +56,18 @@ public:
 
 	void ProcessTimeTick(float t, Executor& executor);
 
+	// Prototypes are stored once; each instance only adds a transform and an optional material.
+	// Executors build their acceleration structures on construction, so populate these first.
+	// Only the CPU executor traces instances; the GPU kernel does not support them yet.
+	inline size_t AddPrototype(const Prototype& prototype) { m_prototypes.push_back(prototype); return m_prototypes.size() - 1; }
+	inline void AddInstance(const Instance& instance) { m_instances.push_back(instance); }
+
 	inline const std::vector<Cuboid>& 	GetCuboidLights() const { return m_cuboidLights; }
 	inline const std::vector<Plane>&	GetPlanes() const { return m_planes; }
 	inline const std::vector<Cuboid>& 	GetCuboids() const { return m_cuboids; }
 	inline const std::vector<Sphere>&	GetSpheres() const { return m_spheres; }
+	inline const std::vector<Prototype>&	GetPrototypes() const { return m_prototypes; }
+	inline const std::vector<Instance>&	GetInstances() const { return m_instances; }
 	inline const Viewpoint&				GetViewpoint() const { return m_viewpoint; }
 
 private:
@@ -65,6 +75,8 @@ private:
 	std::vector<Cuboid> 	m_cuboids;
 	std::vector<Cuboid>		m_cuboidLights;
 	std::vector<Sphere>		m_spheres;
+	std::vector<Prototype>	m_prototypes;
+	std::vector<Instance>	m_instances;
 
 	Vector 					m_velocity;
 	Viewpoint				m_viewpoint;
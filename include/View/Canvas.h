@@ -2,12 +2,14 @@
 
 #include <SDL2/SDL.h>
 
+#include "View/FrameSink.h"
+
 #define WINDOW_W 820
 #define WINDOW_H 820
 
 constexpr int NUM_PIXELS = WINDOW_W * WINDOW_H;
 
-class Canvas {
+class Canvas : public FrameSink {
 public:
     Canvas();
     ~Canvas();
@@ -15,7 +17,7 @@ public:
     inline SDL_Window* GetWindow() { return m_pWindow; };
     inline SDL_Renderer* GetRenderer() { return m_pRenderer; };
 
-	void ApplyPixels(uint32_t* pixels);
+	void PublishFrame(const uint32_t* pixels) override;
 
 private:
     SDL_Window* m_pWindow;
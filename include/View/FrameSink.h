@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+// Destination for finished, tonemapped WINDOW_W x WINDOW_H ARGB8888 frames.
+// Implementations must not hold the renderer up: anything slow happens elsewhere or is dropped.
+class FrameSink {
+public:
+	virtual ~FrameSink() = default;
+
+	virtual void PublishFrame(const uint32_t* pixels) = 0;
+};
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Writes ARGB8888 pixels (the layout produced by ToUint32) as a binary PPM.
+bool WritePpm(const std::string& path, const uint32_t* pixels, int width, int height);
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "View/Canvas.h"
+#include "View/FrameSink.h"
+
+#define SHARED_FRAME_MAGIC 0x52544652u	// "RTFR"
+#define SHARED_FRAME_VERSION 1
+#define SHARED_FRAME_SLOTS 3
+
+// Layout of the shared-memory object, for viewers to map read-only:
+//
+//   SharedFrameHeader, then m_slotCount x SharedFrameSlot (each followed by its pixels)
+//
+// Frame n goes to slot n % m_slotCount. A slot's sequence is odd while the renderer is
+// writing it and 2n + 2 once frame n is complete. Readers take the slot for the latest
+// frame, read the sequence, use the pixels in place and re-read the sequence; if it
+// changed or was odd, the frame was overwritten and should be skipped.
+struct SharedFrameHeader {
+	uint32_t				m_magic;
+	uint32_t				m_version;
+	uint32_t				m_width;
+	uint32_t				m_height;
+	uint32_t				m_slotCount;
+	uint32_t				m_slotStride;	// bytes from one slot to the next
+	std::atomic<uint64_t>	m_latestFrame;	// frame number + 1 of the newest complete frame, 0 if none
+};
+
+struct SharedFrameSlot {
+	std::atomic<uint64_t>	m_sequence;
+	uint64_t				m_frame;
+	// uint32_t pixels[m_width * m_height] follow, 64-byte aligned
+};
+
+constexpr size_t SHARED_FRAME_HEADER_SIZE = 64;
+constexpr size_t SHARED_FRAME_SLOT_HEADER_SIZE = 64;
+
+class SharedMemorySink : public FrameSink {
+public:
+	// name is a POSIX shared-memory name, e.g. "/raytracer"
+	SharedMemorySink(const std::string& name);
+	~SharedMemorySink();
+
+	inline bool IsOpen() const { return m_header != nullptr; }
+
+	void PublishFrame(const uint32_t* pixels) override;
+
+private:
+	SharedFrameSlot* GetSlot(uint64_t frame);
+
+	std::string			m_name;
+	size_t				m_size;
+	SharedFrameHeader*	m_header;
+	uint64_t			m_frame;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "View/Canvas.h"
+#include "View/FrameSink.h"
+
+#define SOCKET_TILE_SIZE 32
+#define SOCKET_TILE_MAGIC 0x54494C45u	// "TILE"
+
+// The stream is unauthenticated, so only local viewers can connect unless asked otherwise
+#define SOCKET_DEFAULT_BIND_ADDRESS "127.0.0.1"
+
+// Every message is a TileMessageHeader followed by m_width * m_height ARGB8888 pixels,
+// row by row, all in host byte order. A frame is complete when the message with
+// m_lastInFrame set arrives; a client that has just connected is first sent every tile.
+struct TileMessageHeader {
+	uint32_t	m_magic;
+	uint32_t	m_frame;
+	uint16_t	m_x;
+	uint16_t	m_y;
+	uint16_t	m_width;
+	uint16_t	m_height;
+	uint32_t	m_lastInFrame;
+};
+
+// Streams changed tiles over TCP. Sockets are non-blocking: a client that cannot keep up
+// simply skips frames, and is sent the difference against the last frame it fully received.
+// bindAddress is a dotted IPv4 address; "0.0.0.0" exposes the framebuffer to the whole network.
+class TileSocketSink : public FrameSink {
+public:
+	TileSocketSink(uint16_t port, const std::string& bindAddress = SOCKET_DEFAULT_BIND_ADDRESS);
+	~TileSocketSink();
+
+	inline bool IsOpen() const { return m_listenSocket >= 0; }
+
+	void PublishFrame(const uint32_t* pixels) override;
+
+private:
+	struct Client {
+		int						m_socket;
+		std::vector<uint32_t>	m_lastSent;		// empty until the first full frame is queued
+		std::vector<char>		m_pending;
+		size_t					m_pendingOffset;
+	};
+
+	void AcceptClients();
+	void QueueChangedTiles(Client& client, const uint32_t* pixels);
+	bool Flush(Client& client);
+
+	int										m_listenSocket;
+	std::vector<std::unique_ptr<Client>>	m_clients;
+	uint32_t								m_frame;
+};
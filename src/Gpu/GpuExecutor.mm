@@ -29,6 +29,11 @@ GpuExecutor::GpuExecutor(const World& world) :
 
 		InitialisePipeline();
 	}
+
+	if (!m_world.GetInstances().empty()) {
+		std::cerr << "Warning: the GPU executor does not trace instances yet; "
+			<< m_world.GetInstances().size() << " instance(s) will be missing. Build with GPU_BUILD 0 to render them.\n";
+	}
 }
 
 GpuExecutor::~GpuExecutor() {
@@ -0,0 +1,111 @@
+#include "Model/BatchRenderer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <latch>
+
+#include "View/ImageWriter.h"
+
+
+BatchRenderer::BatchRenderer(const World& world, WorkerPool& pool) :
+	m_tracer{world},
+	m_pool{pool},
+	m_tiles{ MakeTiles(WINDOW_W, WINDOW_H, TILE_SIZE) },
+	m_framesInFlight{BATCH_FRAMES_IN_FLIGHT}
+{
+}
+
+BatchStatistics BatchRenderer::Render(const std::vector<Viewpoint>& viewpoints, size_t samplesPerFrame, const std::string& outputPrefix) {
+	if (samplesPerFrame == 0) samplesPerFrame = 1;
+
+	// Fail before hours of rendering rather than after, if the output cannot be written
+	if (!viewpoints.empty()) {
+		std::string probePath = GetFramePath(outputPrefix, 0);
+		if (!std::ofstream(probePath, std::ios::binary)) {
+			std::cerr << "Cannot write " << probePath << "; nothing was rendered.\n";
+			return BatchStatistics{ 0, 0.0, 0.0, viewpoints.size() };
+		}
+		std::remove(probePath.c_str());
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::vector<std::unique_ptr<FrameJob>> frames;
+	frames.reserve(viewpoints.size());
+
+	std::latch allFramesDone(viewpoints.size());
+	std::atomic<size_t> failedWrites{0};
+
+	// Tiles of the next frames are queued behind the current one, so workers that
+	// run out of tiles in frame N move straight on to frame N+1.
+	for (size_t f = 0; f < viewpoints.size(); ++f) {
+		m_framesInFlight.acquire();
+
+		frames.push_back(std::make_unique<FrameJob>());
+		FrameJob& frame = *frames.back();
+		frame.m_index = f;
+		frame.m_viewpoint = viewpoints[f];
+		frame.m_accumulator.assign(NUM_PIXELS, COLOUR_BLACK);
+		frame.m_remainingTiles = m_tiles.size();
+
+		for (const Tile& tile : m_tiles) {
+			m_pool.Submit([this, &frame, &tile, samplesPerFrame, &outputPrefix, &allFramesDone, &failedWrites]() {
+				TraceTile(frame, tile, samplesPerFrame);
+
+				if (frame.m_remainingTiles.fetch_sub(1) == 1) {
+					if (!FinishFrame(frame, outputPrefix)) ++failedWrites;
+					m_framesInFlight.release();
+					allFramesDone.count_down();
+				}
+			});
+		}
+	}
+
+	allFramesDone.wait();
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	BatchStatistics stats{ viewpoints.size(), seconds, (seconds > 0.0) ? viewpoints.size() * 3600.0 / seconds : 0.0, failedWrites };
+
+	std::cout << "Rendered " << stats.m_frames << " frames at " << samplesPerFrame << " spp in "
+		<< stats.m_seconds << "s (" << stats.m_framesPerHour << " frames/hour)\n";
+	if (stats.m_failedWrites > 0) std::cerr << stats.m_failedWrites << " frame(s) could not be written.\n";
+
+	return stats;
+}
+
+void BatchRenderer::TraceTile(FrameJob& frame, const Tile& tile, size_t samplesPerFrame) {
+	for (int y = tile.m_y0; y < tile.m_y1; ++y) {
+		for (int x = tile.m_x0; x < tile.m_x1; ++x) {
+			size_t i = y * WINDOW_W + x;
+
+			Colour sum = COLOUR_BLACK;
+			for (size_t s = 0; s < samplesPerFrame; ++s) {
+				sum = sum + m_tracer.TraceRay(frame.m_viewpoint, i);
+			}
+
+			frame.m_accumulator[i] = sum / samplesPerFrame;
+		}
+	}
+}
+
+std::string BatchRenderer::GetFramePath(const std::string& outputPrefix, size_t index) {
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), "_%05zu.ppm", index);
+	return outputPrefix + suffix;
+}
+
+bool BatchRenderer::FinishFrame(FrameJob& frame, const std::string& outputPrefix) {
+	std::vector<uint32_t> pixels(NUM_PIXELS);
+	for (int i = 0; i < NUM_PIXELS; ++i) {
+		pixels[i] = ToUint32( GammaCorrect(frame.m_accumulator[i]) );
+	}
+
+	bool written = WritePpm(GetFramePath(outputPrefix, frame.m_index), pixels.data(), WINDOW_W, WINDOW_H);
+
+	// Release the frame's memory now rather than at the end of the sequence
+	std::vector<Colour>().swap(frame.m_accumulator);
+
+	return written;
+}
@@ -0,0 +1,64 @@
+#include "Model/Bvh.h"
+
+#include <algorithm>
+#include <numeric>
+
+
+Bvh::Bvh() :
+	m_nodes{},
+	m_indices{}
+{
+}
+
+void Bvh::Build(const std::vector<Bounds>& primitiveBounds) {
+	m_nodes.clear();
+	m_indices.resize(primitiveBounds.size());
+	std::iota(m_indices.begin(), m_indices.end(), 0);
+
+	if (primitiveBounds.empty()) return;
+
+	m_nodes.reserve(2 * primitiveBounds.size());
+	BuildRecursive(primitiveBounds, 0, static_cast<uint32_t>(primitiveBounds.size()));
+}
+
+uint32_t Bvh::BuildRecursive(const std::vector<Bounds>& primitiveBounds, uint32_t start, uint32_t count) {
+	uint32_t nodeIndex = static_cast<uint32_t>(m_nodes.size());
+	m_nodes.push_back(BvhNode{});
+
+	Bounds bounds = primitiveBounds[m_indices[start]];
+	Bounds centroids{ bounds.m_min + 0.5f * (bounds.m_max - bounds.m_min), bounds.m_min + 0.5f * (bounds.m_max - bounds.m_min) };
+	for (uint32_t p = start; p < start + count; ++p) {
+		const Bounds& b = primitiveBounds[m_indices[p]];
+		Vector centre = b.m_min + 0.5f * (b.m_max - b.m_min);
+		bounds = Union(bounds, b);
+		centroids = Union(centroids, Bounds{ centre, centre });
+	}
+
+	if (count <= BVH_LEAF_SIZE) {
+		m_nodes[nodeIndex] = BvhNode{ bounds, start, count };
+		return nodeIndex;
+	}
+
+	// Median split along the axis where the centroids are most spread out
+	Vector extent = centroids.m_max - centroids.m_min;
+	int axis = (extent.m_x > extent.m_y && extent.m_x > extent.m_z) ? 0 : (extent.m_y > extent.m_z) ? 1 : 2;
+
+	auto centreOnAxis = [&primitiveBounds, axis](uint32_t index) {
+		const Bounds& b = primitiveBounds[index];
+		switch (axis) {
+			case 0: return b.m_min.m_x + b.m_max.m_x;
+			case 1: return b.m_min.m_y + b.m_max.m_y;
+			default: return b.m_min.m_z + b.m_max.m_z;
+		}
+	};
+
+	uint32_t half = count / 2;
+	std::nth_element(m_indices.begin() + start, m_indices.begin() + start + half, m_indices.begin() + start + count,
+		[&centreOnAxis](uint32_t a, uint32_t b) { return centreOnAxis(a) < centreOnAxis(b); });
+
+	BuildRecursive(primitiveBounds, start, half);
+	uint32_t right = BuildRecursive(primitiveBounds, start + half, count - half);
+
+	m_nodes[nodeIndex] = BvhNode{ bounds, right, 0 };
+	return nodeIndex;
+}
@@ -0,0 +1,90 @@
+#include "Model/CameraPath.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+
+CameraPath::CameraPath() :
+	m_keyframes{}
+{
+}
+
+void CameraPath::AddKeyframe(float time, const Viewpoint& viewpoint) {
+	auto it = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), time,
+		[](float t, const CameraKeyframe& k) { return t < k.m_time; });
+	m_keyframes.insert(it, CameraKeyframe{ time, viewpoint });
+}
+
+bool CameraPath::LoadFromFile(const std::string& path) {
+	std::ifstream file(path);
+	if (!file) {
+		std::cerr << "Failed to open camera path " << path << ".\n";
+		return false;
+	}
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		++lineNumber;
+		if (line.empty() || line[0] == '#') continue;
+
+		std::istringstream stream(line);
+		float time;
+		Viewpoint viewpoint{};
+		stream >> time
+			>> viewpoint.m_position.m_x >> viewpoint.m_position.m_y >> viewpoint.m_position.m_z
+			>> viewpoint.m_direction.m_x >> viewpoint.m_direction.m_y;
+
+		if (!stream) {
+			std::cerr << path << ":" << lineNumber << ": expected \"time px py pz yaw pitch\".\n";
+			return false;
+		}
+
+		AddKeyframe(time, viewpoint);
+	}
+
+	return !m_keyframes.empty();
+}
+
+Viewpoint CameraPath::Evaluate(float time) const {
+	if (m_keyframes.empty()) return Viewpoint{};
+	if (time <= m_keyframes.front().m_time) return m_keyframes.front().m_viewpoint;
+	if (time >= m_keyframes.back().m_time) return m_keyframes.back().m_viewpoint;
+
+	auto next = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), time,
+		[](float t, const CameraKeyframe& k) { return t < k.m_time; });
+	auto prev = next - 1;
+
+	float s = (time - prev->m_time) / (next->m_time - prev->m_time);
+
+	const Viewpoint& a = prev->m_viewpoint;
+	const Viewpoint& b = next->m_viewpoint;
+
+	return Viewpoint{
+		a.m_position + s * (b.m_position - a.m_position),
+		a.m_direction + s * (b.m_direction - a.m_direction)
+	};
+}
+
+std::vector<Viewpoint> CameraPath::Sample(size_t numFrames) const {
+	std::vector<Viewpoint> viewpoints;
+	if (m_keyframes.empty() || numFrames == 0) return viewpoints;
+
+	float start = m_keyframes.front().m_time;
+	float end = m_keyframes.back().m_time;
+
+	for (size_t f = 0; f < numFrames; ++f) {
+		float s = (numFrames == 1) ? 0.0f : static_cast<float>(f) / (numFrames - 1);
+		viewpoints.push_back(Evaluate(start + s * (end - start)));
+	}
+
+	return viewpoints;
+}
+
+std::vector<Viewpoint> CameraPath::GetKeyframeViewpoints() const {
+	std::vector<Viewpoint> viewpoints;
+	for (const CameraKeyframe& keyframe : m_keyframes) viewpoints.push_back(keyframe.m_viewpoint);
+	return viewpoints;
+}
@@ -1,12 +1,49 @@
 #include "Model/CpuExecutor.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <latch>
 
-CpuExecutor::CpuExecutor(const World& world) :
+#include "View/ImageWriter.h"
+
+// Rotated-grid offsets within a pixel; only the first m_subpixelSamples are used
+constexpr float SUBPIXEL_OFFSETS[MAX_SUBPIXEL_SAMPLES][2] = {
+	{ 0.375f, 0.125f },
+	{ 0.875f, 0.375f },
+	{ 0.625f, 0.875f },
+	{ 0.125f, 0.625f },
+};
+
+
+CpuExecutor::CpuExecutor(const World& world, const CpuExecutorOptions& options) :
 	m_world{world},
+	m_layout{ WINDOW_W, WINDOW_H, options.m_tiledLayout },
+	m_radianceCache{ options.m_radianceCache ? std::make_unique<RadianceCache>() : nullptr },
+	m_tracer{world},
+	m_pool{options.m_numThreads},
+	m_tiles{ MakeTiles(WINDOW_W, WINDOW_H, options.m_tileSize) },
+	m_schedule{},
+	m_cost(m_layout.GetStorageSize(), RayCost{ 0, 0 }),
+	m_costSchedule{options.m_costSchedule},
+	m_showCost{false},
+	m_gBufferCache{options.m_gBufferCache},
+	m_subpixelSamples{ std::clamp(options.m_subpixelSamples, 1, MAX_SUBPIXEL_SAMPLES) },
+	m_passIndex{0},
+	m_gBuffer{},
+	m_gBufferFilled{},
+	m_gBufferViewpoint{},
 	m_accumulator{},
-	m_accumulationCount{1}
+	m_accumulationCount{0}
 {
-	m_accumulator = new Colour[NUM_PIXELS];
+	m_tracer.SetRadianceCache(m_radianceCache.get());
+
+	if (m_gBufferCache) {
+		m_gBuffer.resize(m_subpixelSamples * m_layout.GetStorageSize());
+		m_gBufferFilled.assign(m_subpixelSamples, false);
+	}
+
+	m_accumulator = new Colour[m_layout.GetStorageSize()];
 	RefreshAccumulator();
 }
 
@@ -15,222 +52,209 @@ CpuExecutor::~CpuExecutor() {
 }
 
 void CpuExecutor::TraceRays(uint32_t* pixelBuffer) {
-	Colour* rayBuffer = new Colour[NUM_PIXELS];
-
-	std::vector<std::thread> threads;
-	for (int t = 0; t < NUM_THREADS; ++t) {
-		int start = t * RAYS_PER_THREAD;
-		int end  = (t == NUM_THREADS - 1) ? NUM_PIXELS : start + RAYS_PER_THREAD;
+	const Viewpoint viewpoint = m_world.GetViewpoint();
 
-		threads.emplace_back([this, start, end, rayBuffer]() {
-        for (int i = start; i < end; ++i)
-            TraceRay(rayBuffer, i);
-    	});
-	}
+	// Count this pass before resolving so the first frame after a refresh divides by one
+	++m_accumulationCount;
 
-	for (auto& th : threads) th.join();
+	ScheduleTiles();
+	UpdateGBuffer(viewpoint);
 
-	for (int i = 0; i < NUM_PIXELS; ++i) {
-		m_accumulator[i] = m_accumulator[i] + rayBuffer[i];
+	std::latch done(m_schedule.size());
+	for (const Tile& tile : m_schedule) {
+		m_pool.Submit([this, &tile, &viewpoint, pixelBuffer, &done]() {
+			TraceTile(tile, viewpoint, pixelBuffer);
+			done.count_down();
+		});
 	}
+	done.wait();
 
-	for (int i = 0; i < NUM_PIXELS; ++i) {
-		pixelBuffer[i] = ToUint32( GammaCorrect(m_accumulator[i] / m_accumulationCount) );
-	}
+	if (m_gBufferCache) m_gBufferFilled[m_passIndex % m_subpixelSamples] = true;
+	++m_passIndex;
 
-	++m_accumulationCount;
-	delete[] rayBuffer;
+	if (m_showCost) ResolveCostHeatmap(pixelBuffer);
 }
 
-Ray CpuExecutor::GenerateInitialRay(size_t i) {
-	float dx = ( ( (i % WINDOW_W) / static_cast<float>(WINDOW_W - 1) ) * 2 ) - 1;
-	float dy = ( ( (i / WINDOW_W) / static_cast<float>(WINDOW_H - 1) ) * -2 ) + 1;
-	float dz = 0.5f; // normal lens
-	//float dz = sqrt( 1 - (dx * dx) - (dy * dy) ); // -- > fisheye lens
+// Primary hits only depend on the camera, so they are kept until it moves
+void CpuExecutor::UpdateGBuffer(const Viewpoint& viewpoint) {
+	if (!m_gBufferCache) return;
 
-	return Ray{ Vector{ 0.0f, 0.0f, 0.0f }, Vector{ dx, dy, dz }, COLOUR_WHITE };
-}
+	bool cameraMoved = memcmp(&viewpoint, &m_gBufferViewpoint, sizeof(Viewpoint)) != 0;
 
-void CpuExecutor::RefreshAccumulator() {
-	memset(m_accumulator, 0.0f, NUM_PIXELS * sizeof(Colour));
-	m_accumulationCount = 0;
+	if (m_world.HasViewChanged() || m_world.IsMoving() || cameraMoved) {
+		m_gBufferFilled.assign(m_subpixelSamples, false);
+		m_gBufferViewpoint = viewpoint;
+	}
 }
 
-float CpuExecutor::Rand_11() {
-	float r = Rand01();
-	return (r * 2) - 1.0f;
-}
+// Longest-processing-time-first: the pool is FIFO, so the most expensive tiles of the last
+// frame start first and the cheap ones fill in the gaps at the end, shrinking the frame's tail.
+void CpuExecutor::ScheduleTiles() {
+	if (!m_costSchedule) {
+		m_schedule = m_tiles;
+		return;
+	}
 
-float CpuExecutor::Rand01() {
-	static std::mt19937 rng{ std::random_device{}() };
-	static std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+	uint64_t totalCost = 0;
+	for (const RayCost& cost : m_cost) totalCost += cost.m_intersectionTests;
 
-	return dist(rng);
-}
+	double splitCost = COST_SPLIT_FACTOR * static_cast<double>(totalCost) / NUM_PIXELS;
 
-Vector CpuExecutor::Scatter(const Vector& normal) {
-	Vector random{ Rand_11(), Rand_11(), Rand_11() };
-	return Normalise(normal + random);
-}
+	std::vector<TileCost> tiles;
+	tiles.reserve(m_tiles.size());
+	for (const Tile& tile : m_tiles) SplitTile(tile, splitCost, tiles);
+
+	std::stable_sort(tiles.begin(), tiles.end(), [](const TileCost& a, const TileCost& b) { return a.m_cost > b.m_cost; });
 
-bool CpuExecutor::ShouldSpectralReflect(float reflectIndex) {
-	return (Rand01() < reflectIndex);
+	m_schedule.clear();
+	for (const TileCost& tile : tiles) m_schedule.push_back(tile.m_tile);
 }
 
-void CpuExecutor::CalculateNextRay(Ray& ray, const Collision& collision) {
-	// Is the material finalising?
-	if (collision.m_material.m_final) {
-		ray.m_colour = Filter(ray.m_colour, collision.m_material.m_colour);
+void CpuExecutor::SplitTile(const Tile& tile, double splitCost, std::vector<TileCost>& tiles) const {
+	uint64_t cost = GetTileCost(tile);
+
+	int width = tile.m_x1 - tile.m_x0;
+	int height = tile.m_y1 - tile.m_y0;
+	double costPerPixel = static_cast<double>(cost) / (width * height);
+
+	if (splitCost <= 0.0 || costPerPixel <= splitCost || width < 2 * MIN_TILE_SIZE || height < 2 * MIN_TILE_SIZE) {
+		tiles.push_back(TileCost{ tile, cost });
 		return;
 	}
 
-	// Calculate ray energy
-	if (ShouldSpectralReflect(collision.m_material.m_reflectionIndex)) {
-		// Spectral Reflection
-		ray.m_vel = Reflect(ray.m_vel, collision.m_normal);
-	} else {
-		// Diffuse Reflection
-		ray.m_vel = Scatter(collision.m_normal);
-		Colour newRayColour = Dampen(Filter(ray.m_colour, collision.m_material.m_colour), DIFFUSE_DAMPEN_FACTOR);
-		ray.m_colour = newRayColour;
-	}
+	int midX = tile.m_x0 + width / 2;
+	int midY = tile.m_y0 + height / 2;
 
-	ray.m_pos = collision.m_location;
+	SplitTile(Tile{ tile.m_x0, tile.m_y0, midX, midY }, splitCost, tiles);
+	SplitTile(Tile{ midX, tile.m_y0, tile.m_x1, midY }, splitCost, tiles);
+	SplitTile(Tile{ tile.m_x0, midY, midX, tile.m_y1 }, splitCost, tiles);
+	SplitTile(Tile{ midX, midY, tile.m_x1, tile.m_y1 }, splitCost, tiles);
 }
 
-bool CpuExecutor::TryCollision(const Plane& plane, const Ray& ray, Collision& bestCollision) {
-	float t;
-	Vector normal;
-
-	switch (plane.m_axis) {
-		case AXIS::X: {
-			t = (plane.m_offset - ray.m_pos.m_x) / ray.m_vel.m_x;
-			normal = (ray.m_vel.m_x > 0) ? Vector{ -1.0f, 0.0f, 0.0f } : Vector{ 1.0f, 0.0f, 0.0f };
-			break;
-		}
-		case AXIS::Y: {
-			t = (plane.m_offset - ray.m_pos.m_y) / ray.m_vel.m_y;
-			normal = (ray.m_vel.m_y > 0) ? Vector{ 0.0f, -1.0f, 0.0f } : Vector{ 0.0f, 1.0f, 0.0f };
-			break;
-		}
-		case AXIS::Z: {
-			t = (plane.m_offset - ray.m_pos.m_z) / ray.m_vel.m_z;
-			normal = (ray.m_vel.m_z > 0) ? Vector{ 0.0f, 0.0f, -1.0f } : Vector{ 0.0f, 0.0f, 1.0f };
-			break;
+uint64_t CpuExecutor::GetTileCost(const Tile& tile) const {
+	uint64_t cost = 0;
+	for (int y = tile.m_y0; y < tile.m_y1; ++y) {
+		for (int x = tile.m_x0; x < tile.m_x1; ++x) {
+			cost += m_cost[m_layout.GetIndex(x, y)].m_intersectionTests;
 		}
 	}
-
-	if (t < EPSILON || bestCollision.m_t < t) return false;
-
-	bestCollision.m_t = t;
-	bestCollision.m_normal = normal;
-	bestCollision.m_location = ray.m_pos + t * ray.m_vel + EPSILON * normal;
-	bestCollision.m_material = plane.m_material;
-
-	return true;
+	return cost;
 }
 
-bool CpuExecutor::TryCollision(const Cuboid& cuboid, const Ray& ray, Collision& bestCollision) {
-	const Vector& min = cuboid.m_min;
-	const Vector& max = cuboid.m_max;
-
-	float xT1 = (min.m_x - ray.m_pos.m_x) / ray.m_vel.m_x;
-	float xT2 = (max.m_x - ray.m_pos.m_x) / ray.m_vel.m_x;
-
-	float yT1 = (min.m_y - ray.m_pos.m_y) / ray.m_vel.m_y;
-	float yT2 = (max.m_y - ray.m_pos.m_y) / ray.m_vel.m_y;
-
-	float zT1 = (min.m_z - ray.m_pos.m_z) / ray.m_vel.m_z;
-	float zT2 = (max.m_z - ray.m_pos.m_z) / ray.m_vel.m_z;
-
-	float xMinT = (xT1 < xT2) ? xT1 : xT2;
-	float xMaxT = (xT1 > xT2) ? xT1 : xT2;
+// With the tiled layout the tile is walked in Morton order, so consecutive rays are close on
+// screen and likely to touch the same BVH nodes, and their buffer slots are adjacent in memory.
+void CpuExecutor::TraceTile(const Tile& tile, const Viewpoint& viewpoint, uint32_t* pixelBuffer) {
+	int subpixel = static_cast<int>(m_passIndex % m_subpixelSamples);
+	float offsetX = (m_subpixelSamples > 1) ? SUBPIXEL_OFFSETS[subpixel][0] : 0.5f;
+	float offsetY = (m_subpixelSamples > 1) ? SUBPIXEL_OFFSETS[subpixel][1] : 0.5f;
 
-	float yMinT = (yT1 < yT2) ? yT1 : yT2;
-	float yMaxT = (yT1 > yT2) ? yT1 : yT2;
+	PrimaryHit* gBuffer = m_gBufferCache ? &m_gBuffer[subpixel * m_layout.GetStorageSize()] : nullptr;
+	bool gBufferFilled = m_gBufferCache && m_gBufferFilled[subpixel];
 
-	float zMinT = (zT1 < zT2) ? zT1 : zT2;
-	float zMaxT = (zT1 > zT2) ? zT1 : zT2;
+	if (m_layout.IsTiled()) {
+		uint32_t width = tile.m_x1 - tile.m_x0;
+		uint32_t height = tile.m_y1 - tile.m_y0;
 
-	float tEnter = xMinT;
-	AXIS axis = AXIS::X;
+		uint32_t extent = 1;
+		while (extent < width || extent < height) extent <<= 1;
 
-	if (yMinT > tEnter) {
-		tEnter = yMinT;
-		axis = AXIS::Y;
-	}
+		for (uint32_t code = 0; code < extent * extent; ++code) {
+			uint32_t x, y;
+			MortonDecode(code, x, y);
+			if (x >= width || y >= height) continue;
 
-	if (zMinT > tEnter) {
-		tEnter = zMinT;
-		axis = AXIS::Z;
+			TracePixel(tile.m_x0 + x, tile.m_y0 + y, viewpoint, gBuffer, gBufferFilled, offsetX, offsetY);
+		}
+	} else {
+		for (int y = tile.m_y0; y < tile.m_y1; ++y) {
+			for (int x = tile.m_x0; x < tile.m_x1; ++x) {
+				TracePixel(x, y, viewpoint, gBuffer, gBufferFilled, offsetX, offsetY);
+			}
+		}
 	}
 
-	float tExit = (xMaxT < yMaxT) ? xMaxT : yMaxT;
-	tExit = (tExit < zMaxT) ? tExit : zMaxT;
+	ResolveTile(tile, pixelBuffer);
+}
 
-	if (tExit < EPSILON || tEnter > tExit || bestCollision.m_t < tEnter) return false;
+void CpuExecutor::TracePixel(int x, int y, const Viewpoint& viewpoint, PrimaryHit* gBuffer, bool gBufferFilled, float offsetX, float offsetY) {
+	size_t i = m_layout.GetIndex(x, y);
 
-	Vector normal;
-	switch (axis) {
-		case AXIS::X: {
-			normal = (ray.m_vel.m_x > 0) ? Vector(-1.0f, 0.0f, 0.0f) : Vector(1.0f, 0.0f, 0.0f);
-			break;
-		}
-		case AXIS::Y: {
-			normal = (ray.m_vel.m_y > 0) ? Vector(0.0f, -1.0f, 0.0f) : Vector(0.0f, 1.0f, 0.0f);
-			break;
-		}
-		case AXIS::Z: {
-			normal = (ray.m_vel.m_z > 0) ? Vector(0.0f, 0.0f, -1.0f) : Vector(0.0f, 0.0f, 1.0f);
-			break;
-		}
-	}
+	RayCost primaryCost{ 0, 0 };
+	PrimaryHit primaryHit = gBufferFilled ? gBuffer[i] : m_tracer.TracePrimaryHit(viewpoint, x, y, WINDOW_W, WINDOW_H, offsetX, offsetY, &primaryCost);
+	if (gBuffer && !gBufferFilled) gBuffer[i] = primaryHit;
 
-	bestCollision.m_t = tEnter;
-	bestCollision.m_normal = normal;
-	bestCollision.m_location = ray.m_pos + tEnter * ray.m_vel + EPSILON * normal;
-	bestCollision.m_material = cuboid.m_material;
+	Colour colour = m_tracer.TraceFromPrimaryHit(primaryHit, viewpoint, x, y, WINDOW_W, WINDOW_H, offsetX, offsetY, &m_cost[i]);
+	m_cost[i].m_intersectionTests += primaryCost.m_intersectionTests;
 
-	return true;
+	m_accumulator[i] = m_accumulator[i] + colour;
 }
 
-void CpuExecutor::TraceRay(Colour* buffer, size_t i) {
-	Ray ray = GenerateInitialRay(i);
+// De-tiles the tile into the row-major pixel buffer. Within a row the Morton index only
+// changes in its x bits, so the y half is spread once per row.
+void CpuExecutor::ResolveTile(const Tile& tile, uint32_t* pixelBuffer) const {
+	float inverseCount = 1.0f / m_accumulationCount;
 
-	Collision bestCollision;
+	for (int y = tile.m_y0; y < tile.m_y1; ++y) {
+		uint32_t* row = pixelBuffer + static_cast<size_t>(y) * WINDOW_W;
 
-	int collisions{0};
-	while (collisions < MAX_COLLISIONS) {
-		bestCollision = Collision{ FLT_MAX, Vector{}, Vector{}, Material{} };
-
-		for (const Cuboid& cuboidLight : m_world.GetCuboidLights()) TryCollision(cuboidLight, ray, bestCollision);
-		for (const Plane& plane : m_world.GetPlanes()) TryCollision(plane, ray, bestCollision);
-		for (const Cuboid& cuboid : m_world.GetCuboids()) TryCollision(cuboid, ray, bestCollision);
+		if (!m_layout.IsTiled()) {
+			const Colour* accumulated = m_accumulator + static_cast<size_t>(y) * WINDOW_W;
+			for (int x = tile.m_x0; x < tile.m_x1; ++x) {
+				row[x] = ToUint32( GammaCorrect(accumulated[x] * inverseCount) );
+			}
+			continue;
+		}
 
-		CalculateNextRay(ray, bestCollision);
+		size_t rowBase = m_layout.GetIndex(tile.m_x0, y) & ~static_cast<size_t>(MortonEncode(LAYOUT_TILE_SIZE - 1, 0));
+		for (int x = tile.m_x0; x < tile.m_x1; ++x) {
+			if ((x & (LAYOUT_TILE_SIZE - 1)) == 0 && x != tile.m_x0) {
+				rowBase = m_layout.GetIndex(x, y);
+			}
+			row[x] = ToUint32( GammaCorrect(m_accumulator[rowBase | SpreadBits(x & (LAYOUT_TILE_SIZE - 1))] * inverseCount) );
+		}
+	}
+}
 
-		if (bestCollision.m_material.m_final) {
-			buffer[i] = ray.m_colour;
-			return;
+// Black through blue, red and yellow to white, on a log scale from the cheapest to the
+// most expensive pixel of the latest pass
+void CpuExecutor::ResolveCostHeatmap(uint32_t* pixelBuffer) const {
+	constexpr Colour ramp[] = { COLOUR_BLACK, COLOUR_BLUE, COLOUR_RED, COLOUR_YELLOW, COLOUR_WHITE };
+	constexpr int numStops = sizeof(ramp) / sizeof(ramp[0]);
+
+	// Walk pixels rather than the storage so the tiled layout's padding is left out
+	uint32_t minCost = UINT32_MAX;
+	uint32_t maxCost = 0;
+	for (int y = 0; y < WINDOW_H; ++y) {
+		for (int x = 0; x < WINDOW_W; ++x) {
+			uint32_t cost = m_cost[m_layout.GetIndex(x, y)].m_intersectionTests;
+			minCost = std::min(minCost, cost);
+			maxCost = std::max(maxCost, cost);
 		}
+	}
 
-		float rayEnergy = Max(ray.m_colour);
+	float logMin = log1p(static_cast<float>(minCost));
+	float logRange = log1p(static_cast<float>(maxCost)) - logMin;
+	float scale = (logRange > 0.0f) ? (numStops - 1) / logRange : 0.0f;
 
-		if (rayEnergy < 0.01) break;
+	for (int y = 0; y < WINDOW_H; ++y) {
+		for (int x = 0; x < WINDOW_W; ++x) {
+			float t = (log1p(static_cast<float>(m_cost[m_layout.GetIndex(x, y)].m_intersectionTests)) - logMin) * scale;
+			int stop = std::min(static_cast<int>(t), numStops - 2);
+			float s = t - stop;
 
-		if (collisions > 3) {
-			if (rayEnergy < Rand01()) break;
-			ray.m_colour = ray.m_colour / rayEnergy;
+			pixelBuffer[y * WINDOW_W + x] = ToUint32( ramp[stop] * (1.0f - s) + ramp[stop + 1] * s );
 		}
-
-		++collisions;
 	}
+}
 
-	buffer[i] = COLOUR_BLACK;
+bool CpuExecutor::DumpCostHeatmap(const std::string& path) const {
+	std::vector<uint32_t> pixels(NUM_PIXELS);
+	ResolveCostHeatmap(pixels.data());
+	return WritePpm(path, pixels.data(), WINDOW_W, WINDOW_H);
 }
 
-void CpuExecutor::TraceRayRange(Colour* buffer, size_t start, size_t end) {
-	for (int i = start; i < end; ++i) {
-		TraceRay(buffer, i);
-	}
-}
\ No newline at end of file
+// The radiance cache is deliberately kept: it depends only on the scene, not the view
+void CpuExecutor::RefreshAccumulator() {
+	memset(m_accumulator, 0, m_layout.GetStorageSize() * sizeof(Colour));
+	m_accumulationCount = 0;
+}
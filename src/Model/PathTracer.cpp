@@ -0,0 +1,483 @@
+#include "Model/PathTracer.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+
+PathTracer::PathTracer(const World& world) :
+	m_world{world},
+	m_prototypeBvhs{},
+	m_instances{},
+	m_instanceBvh{},
+	m_materials{},
+	m_materialIndices{},
+	m_radianceCache{}
+{
+	BuildAccelerationStructures();
+	BuildMaterialTable();
+}
+
+size_t PathTracer::MaterialHash::operator()(const Material& material) const {
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&material);
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t b = 0; b < sizeof(Material); ++b) {
+		hash ^= bytes[b];
+		hash *= 0x100000001b3ull;
+	}
+	return static_cast<size_t>(hash);
+}
+
+bool PathTracer::MaterialEqual::operator()(const Material& a, const Material& b) const {
+	return memcmp(&a, &b, sizeof(Material)) == 0;
+}
+
+void PathTracer::AddMaterial(const Material& material) {
+	if (m_materialIndices.emplace(material, static_cast<uint32_t>(m_materials.size())).second) m_materials.push_back(material);
+}
+
+// Every material a hit can carry, so primary hits can store an index instead of a copy
+void PathTracer::BuildMaterialTable() {
+	for (const Cuboid& cuboidLight : m_world.GetCuboidLights()) AddMaterial(cuboidLight.m_material);
+	for (const Plane& plane : m_world.GetPlanes()) AddMaterial(plane.m_material);
+	for (const Cuboid& cuboid : m_world.GetCuboids()) AddMaterial(cuboid.m_material);
+	for (const Sphere& sphere : m_world.GetSpheres()) AddMaterial(sphere.m_material);
+
+	for (const Prototype& prototype : m_world.GetPrototypes()) {
+		for (const Cuboid& cuboid : prototype.m_cuboids) AddMaterial(cuboid.m_material);
+		for (const Sphere& sphere : prototype.m_spheres) AddMaterial(sphere.m_material);
+	}
+
+	for (const PreparedInstance& instance : m_instances) {
+		if (instance.m_overrideMaterial) AddMaterial(instance.m_material);
+	}
+}
+
+void PathTracer::BuildAccelerationStructures() {
+	const std::vector<Prototype>& prototypes = m_world.GetPrototypes();
+
+	// Bottom level: one hierarchy per prototype, cuboids first then spheres
+	m_prototypeBvhs.resize(prototypes.size());
+	for (size_t p = 0; p < prototypes.size(); ++p) {
+		std::vector<Bounds> bounds;
+		for (const Cuboid& cuboid : prototypes[p].m_cuboids) {
+			bounds.push_back(Bounds{ cuboid.m_min, cuboid.m_max });
+		}
+		for (const Sphere& sphere : prototypes[p].m_spheres) {
+			Vector r{ sphere.m_radius, sphere.m_radius, sphere.m_radius };
+			bounds.push_back(Bounds{ sphere.m_position - r, sphere.m_position + r });
+		}
+		m_prototypeBvhs[p].Build(bounds);
+	}
+
+	// Top level: world-space bounds of each placed prototype
+	std::vector<Bounds> instanceBounds;
+	size_t degenerate = 0;
+	for (const Instance& instance : m_world.GetInstances()) {
+		if (instance.m_prototype >= prototypes.size() || m_prototypeBvhs[instance.m_prototype].IsEmpty()) continue;
+
+		const Transform& transform = instance.m_transform;
+		Vector s = transform.m_scale;
+
+		// A zero scale has no inverse and would give the instance NaN bounds
+		if (s.m_x == 0.0f || s.m_y == 0.0f || s.m_z == 0.0f) {
+			++degenerate;
+			continue;
+		}
+
+		Matrix3 rotation = Rotation(transform.m_rotation);
+		Vector inverseScale{ 1.0f / s.m_x, 1.0f / s.m_y, 1.0f / s.m_z };
+
+		Matrix3 toWorld = rotation * Scale(s);
+
+		m_instances.push_back(PreparedInstance{
+			Scale(inverseScale) * Transpose(rotation),
+			rotation * Scale(inverseScale),
+			transform.m_translation,
+			static_cast<uint32_t>(instance.m_prototype),
+			instance.m_overrideMaterial,
+			instance.m_material
+		});
+
+		const Bounds& local = m_prototypeBvhs[instance.m_prototype].GetBounds();
+		Bounds world{ Vector{ FLT_MAX, FLT_MAX, FLT_MAX }, Vector{ -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+		for (int corner = 0; corner < 8; ++corner) {
+			Vector c{
+				(corner & 1) ? local.m_max.m_x : local.m_min.m_x,
+				(corner & 2) ? local.m_max.m_y : local.m_min.m_y,
+				(corner & 4) ? local.m_max.m_z : local.m_min.m_z
+			};
+			Vector w = toWorld * c + transform.m_translation;
+			world = Union(world, Bounds{ w, w });
+		}
+		instanceBounds.push_back(world);
+	}
+
+	if (degenerate > 0) std::cerr << "Skipping " << degenerate << " instance(s) with a zero scale component.\n";
+
+	m_instanceBvh.Build(instanceBounds);
+}
+
+Ray PathTracer::GenerateInitialRay(const Viewpoint& viewpoint, int x, int y, int width, int height, float offsetX, float offsetY) {
+	float u = ( x + offsetX ) / static_cast<float>(width);
+	float v = ( y + offsetY ) / static_cast<float>(height);
+	float aspectRatio = static_cast<float>(width) / static_cast<float>(height);
+
+	float tanHalfFovY = tan(FOV_Y * 0.5f);
+
+	float ndcX = 2.0f * u - 1.0f;
+	float ndcY = 1.0f - 2.0f * v;
+
+	Vector dir = Normalise(Vector{ ndcX * tanHalfFovY * aspectRatio, ndcY * tanHalfFovY, 1.0f });
+
+	// Same yaw-then-pitch rotation as the GPU kernel so both executors agree on the camera
+	float cosT = cos(viewpoint.m_direction.m_x);
+	float sinT = sin(viewpoint.m_direction.m_x);
+
+	Vector yawed{
+		dir.m_x * cosT + dir.m_z * sinT,
+		dir.m_y,
+		-dir.m_x * sinT + dir.m_z * cosT
+	};
+
+	float cosP = cos(viewpoint.m_direction.m_y);
+	float sinP = sin(viewpoint.m_direction.m_y);
+
+	Vector rotated{
+		yawed.m_x,
+		yawed.m_y * cosP - yawed.m_z * sinP,
+		yawed.m_y * sinP + yawed.m_z * cosP
+	};
+
+	return Ray{ viewpoint.m_position, Normalise(rotated), COLOUR_WHITE };
+}
+
+float PathTracer::Rand_11() {
+	float r = Rand01();
+	return (r * 2) - 1.0f;
+}
+
+float PathTracer::Rand01() {
+	thread_local std::mt19937 rng{ std::random_device{}() };
+	thread_local std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+	return dist(rng);
+}
+
+Vector PathTracer::Scatter(const Vector& normal) {
+	Vector random{ Rand_11(), Rand_11(), Rand_11() };
+	return Normalise(normal + random);
+}
+
+bool PathTracer::ShouldSpectralReflect(float reflectIndex) {
+	return (Rand01() < reflectIndex);
+}
+
+void PathTracer::CalculateNextRay(Ray& ray, const Collision& collision, bool spectral) {
+	// Is the material finalising?
+	if (collision.m_material.m_final) {
+		ray.m_colour = Filter(ray.m_colour, collision.m_material.m_colour);
+		return;
+	}
+
+	// Calculate ray energy
+	if (spectral) {
+		// Spectral Reflection
+		ray.m_vel = Reflect(ray.m_vel, collision.m_normal);
+	} else {
+		// Diffuse Reflection
+		ray.m_vel = Scatter(collision.m_normal);
+		Colour newRayColour = Dampen(Filter(ray.m_colour, collision.m_material.m_colour), DIFFUSE_DAMPEN_FACTOR);
+		ray.m_colour = newRayColour;
+	}
+
+	ray.m_pos = collision.m_location;
+}
+
+bool PathTracer::TryCollision(const Plane& plane, const Ray& ray, Collision& bestCollision) {
+	float t;
+	Vector normal;
+
+	switch (plane.m_axis) {
+		case AXIS::X: {
+			t = (plane.m_offset - ray.m_pos.m_x) / ray.m_vel.m_x;
+			normal = (ray.m_vel.m_x > 0) ? Vector{ -1.0f, 0.0f, 0.0f } : Vector{ 1.0f, 0.0f, 0.0f };
+			break;
+		}
+		case AXIS::Y: {
+			t = (plane.m_offset - ray.m_pos.m_y) / ray.m_vel.m_y;
+			normal = (ray.m_vel.m_y > 0) ? Vector{ 0.0f, -1.0f, 0.0f } : Vector{ 0.0f, 1.0f, 0.0f };
+			break;
+		}
+		case AXIS::Z: {
+			t = (plane.m_offset - ray.m_pos.m_z) / ray.m_vel.m_z;
+			normal = (ray.m_vel.m_z > 0) ? Vector{ 0.0f, 0.0f, -1.0f } : Vector{ 0.0f, 0.0f, 1.0f };
+			break;
+		}
+	}
+
+	if (t < EPSILON || bestCollision.m_t < t) return false;
+
+	bestCollision.m_t = t;
+	bestCollision.m_normal = normal;
+	bestCollision.m_location = ray.m_pos + t * ray.m_vel + EPSILON * normal;
+	bestCollision.m_material = plane.m_material;
+
+	return true;
+}
+
+bool PathTracer::TryCollision(const Cuboid& cuboid, const Ray& ray, Collision& bestCollision) {
+	const Vector& min = cuboid.m_min;
+	const Vector& max = cuboid.m_max;
+
+	float xT1 = (min.m_x - ray.m_pos.m_x) / ray.m_vel.m_x;
+	float xT2 = (max.m_x - ray.m_pos.m_x) / ray.m_vel.m_x;
+
+	float yT1 = (min.m_y - ray.m_pos.m_y) / ray.m_vel.m_y;
+	float yT2 = (max.m_y - ray.m_pos.m_y) / ray.m_vel.m_y;
+
+	float zT1 = (min.m_z - ray.m_pos.m_z) / ray.m_vel.m_z;
+	float zT2 = (max.m_z - ray.m_pos.m_z) / ray.m_vel.m_z;
+
+	float xMinT = (xT1 < xT2) ? xT1 : xT2;
+	float xMaxT = (xT1 > xT2) ? xT1 : xT2;
+
+	float yMinT = (yT1 < yT2) ? yT1 : yT2;
+	float yMaxT = (yT1 > yT2) ? yT1 : yT2;
+
+	float zMinT = (zT1 < zT2) ? zT1 : zT2;
+	float zMaxT = (zT1 > zT2) ? zT1 : zT2;
+
+	float tEnter = xMinT;
+	AXIS axis = AXIS::X;
+
+	if (yMinT > tEnter) {
+		tEnter = yMinT;
+		axis = AXIS::Y;
+	}
+
+	if (zMinT > tEnter) {
+		tEnter = zMinT;
+		axis = AXIS::Z;
+	}
+
+	float tExit = (xMaxT < yMaxT) ? xMaxT : yMaxT;
+	tExit = (tExit < zMaxT) ? tExit : zMaxT;
+
+	if (tExit < EPSILON || tEnter > tExit || bestCollision.m_t < tEnter) return false;
+
+	Vector normal;
+	switch (axis) {
+		case AXIS::X: {
+			normal = (ray.m_vel.m_x > 0) ? Vector(-1.0f, 0.0f, 0.0f) : Vector(1.0f, 0.0f, 0.0f);
+			break;
+		}
+		case AXIS::Y: {
+			normal = (ray.m_vel.m_y > 0) ? Vector(0.0f, -1.0f, 0.0f) : Vector(0.0f, 1.0f, 0.0f);
+			break;
+		}
+		case AXIS::Z: {
+			normal = (ray.m_vel.m_z > 0) ? Vector(0.0f, 0.0f, -1.0f) : Vector(0.0f, 0.0f, 1.0f);
+			break;
+		}
+	}
+
+	bestCollision.m_t = tEnter;
+	bestCollision.m_normal = normal;
+	bestCollision.m_location = ray.m_pos + tEnter * ray.m_vel + EPSILON * normal;
+	bestCollision.m_material = cuboid.m_material;
+
+	return true;
+}
+
+bool PathTracer::TryCollision(const Sphere& sphere, const Ray& ray, Collision& bestCollision) {
+	Vector l = ray.m_pos - sphere.m_position;
+
+	float a = Dot(ray.m_vel, ray.m_vel);
+	float b = 2.0f * Dot(ray.m_vel, l);
+	float c = Dot(l, l) - sphere.m_radius * sphere.m_radius;
+
+	float discr = b * b - 4.0f * a * c;
+	if (discr < 0.0f) return false;
+
+	float sqrtDiscr = sqrt(discr);
+
+	// Numerically stable root computation
+	float q = (b > 0.0f) ? -0.5f * (b + sqrtDiscr) : -0.5f * (b - sqrtDiscr);
+
+	float t0 = q / a;
+	float t1 = c / q;
+
+	if (t0 > t1) {
+		float tmp = t0;
+		t0 = t1;
+		t1 = tmp;
+	}
+
+	float t = (t0 > EPSILON) ? t0 : t1;
+	if (t <= EPSILON || bestCollision.m_t < t) return false;
+
+	Vector location = ray.m_pos + t * ray.m_vel;
+	Vector normal = Normalise(location - sphere.m_position);
+
+	bestCollision.m_t = t;
+	bestCollision.m_normal = normal;
+	bestCollision.m_location = location + EPSILON * normal;
+	bestCollision.m_material = sphere.m_material;
+
+	return true;
+}
+
+bool PathTracer::TryCollision(const PreparedInstance& instance, const Ray& ray, Collision& bestCollision, uint32_t& tests) const {
+	// The transform is affine and the direction is not renormalised, so t is the same in both spaces
+	Ray local{ instance.m_toLocal * (ray.m_pos - instance.m_translation), instance.m_toLocal * ray.m_vel, ray.m_colour };
+
+	const Prototype& prototype = m_world.GetPrototypes()[instance.m_prototype];
+	size_t numCuboids = prototype.m_cuboids.size();
+
+	Collision localCollision = bestCollision;
+	bool hit = false;
+
+	m_prototypeBvhs[instance.m_prototype].Traverse(local, localCollision.m_t, [&](uint32_t p) {
+		++tests;
+		if (p < numCuboids) hit |= TryCollision(prototype.m_cuboids[p], local, localCollision);
+		else hit |= TryCollision(prototype.m_spheres[p - numCuboids], local, localCollision);
+	});
+
+	if (!hit) return false;
+
+	Vector normal = instance.m_normalToWorld * localCollision.m_normal;
+	normal = normal * (1.0f / Length(normal));
+
+	bestCollision.m_t = localCollision.m_t;
+	bestCollision.m_normal = normal;
+	bestCollision.m_location = ray.m_pos + localCollision.m_t * ray.m_vel + EPSILON * normal;
+	bestCollision.m_material = instance.m_overrideMaterial ? instance.m_material : localCollision.m_material;
+
+	return true;
+}
+
+void PathTracer::TryInstances(const Ray& ray, Collision& bestCollision, uint32_t& tests) const {
+	m_instanceBvh.Traverse(ray, bestCollision.m_t, [&](uint32_t i) {
+		++tests;
+		TryCollision(m_instances[i], ray, bestCollision, tests);
+	});
+}
+
+uint32_t PathTracer::FindClosestCollision(const Ray& ray, Collision& bestCollision) const {
+	for (const Cuboid& cuboidLight : m_world.GetCuboidLights()) TryCollision(cuboidLight, ray, bestCollision);
+	for (const Plane& plane : m_world.GetPlanes()) TryCollision(plane, ray, bestCollision);
+	for (const Cuboid& cuboid : m_world.GetCuboids()) TryCollision(cuboid, ray, bestCollision);
+	for (const Sphere& sphere : m_world.GetSpheres()) TryCollision(sphere, ray, bestCollision);
+
+	uint32_t tests = static_cast<uint32_t>(m_world.GetCuboidLights().size() + m_world.GetPlanes().size()
+		+ m_world.GetCuboids().size() + m_world.GetSpheres().size());
+
+	TryInstances(ray, bestCollision, tests);
+
+	return tests;
+}
+
+void PathTracer::RecordCacheVertices(const CacheVertex* vertices, int numVertices, const Colour& pathColour) const {
+	for (int v = 0; v < numVertices; ++v) {
+		const Colour& throughput = vertices[v].m_throughput;
+
+		// Radiance leaving the hit is the path's colour with the throughput up to it divided out.
+		// A channel that was already filtered to zero carries no information about that hit.
+		if (throughput.m_red <= 0.0f || throughput.m_green <= 0.0f || throughput.m_blue <= 0.0f) continue;
+
+		Colour radiance{
+			1.0f,
+			pathColour.m_red / throughput.m_red,
+			pathColour.m_green / throughput.m_green,
+			pathColour.m_blue / throughput.m_blue
+		};
+		m_radianceCache->Record(vertices[v].m_location, vertices[v].m_normal, radiance);
+	}
+}
+
+Colour PathTracer::TraceRay(const Viewpoint& viewpoint, int x, int y, int width, int height, RayCost* cost) const {
+	return TracePath(GenerateInitialRay(viewpoint, x, y, width, height, 0.5f, 0.5f), nullptr, cost);
+}
+
+PrimaryHit PathTracer::TracePrimaryHit(const Viewpoint& viewpoint, int x, int y, int width, int height, float offsetX, float offsetY,
+	RayCost* cost) const {
+	Ray ray = GenerateInitialRay(viewpoint, x, y, width, height, offsetX, offsetY);
+
+	Collision collision{ FLT_MAX, Vector{}, Vector{}, Material{} };
+	uint32_t tests = FindClosestCollision(ray, collision);
+	if (cost) *cost = RayCost{ 0, tests };
+
+	if (collision.m_t == FLT_MAX) return PrimaryHit{ Vector{}, Vector{}, PRIMARY_HIT_MISS };
+
+	auto material = m_materialIndices.find(collision.m_material);
+	return PrimaryHit{ collision.m_location, collision.m_normal, (material != m_materialIndices.end()) ? material->second : PRIMARY_HIT_MISS };
+}
+
+Colour PathTracer::TraceFromPrimaryHit(const PrimaryHit& primaryHit, const Viewpoint& viewpoint, int x, int y, int width, int height,
+	float offsetX, float offsetY, RayCost* cost) const {
+	return TracePath(GenerateInitialRay(viewpoint, x, y, width, height, offsetX, offsetY), &primaryHit, cost);
+}
+
+Colour PathTracer::TracePath(Ray ray, const PrimaryHit* primaryHit, RayCost* cost) const {
+	Collision bestCollision;
+	Colour pathColour = COLOUR_BLACK;
+
+	CacheVertex cacheVertices[MAX_COLLISIONS];
+	int numCacheVertices{0};
+
+	RayCost pathCost{ 0, 0 };
+
+	int collisions{0};
+	while (collisions < MAX_COLLISIONS) {
+		if (collisions == 0 && primaryHit) {
+			// Past this point m_t only tells a hit from a miss
+			if (primaryHit->m_material == PRIMARY_HIT_MISS) {
+				bestCollision = Collision{ FLT_MAX, Vector{}, Vector{}, Material{} };
+			} else {
+				bestCollision = Collision{ 0.0f, primaryHit->m_normal, primaryHit->m_location, m_materials[primaryHit->m_material] };
+			}
+		} else {
+			bestCollision = Collision{ FLT_MAX, Vector{}, Vector{}, Material{} };
+			pathCost.m_intersectionTests += FindClosestCollision(ray, bestCollision);
+		}
+		++pathCost.m_bounces;
+
+		const Material& material = bestCollision.m_material;
+		bool spectral = !material.m_final && ShouldSpectralReflect(material.m_reflectionIndex);
+
+		if (m_radianceCache && !material.m_final && !spectral && bestCollision.m_t < FLT_MAX) {
+			Colour cached;
+			if (collisions >= RADIANCE_CACHE_LOOKUP_DEPTH && m_radianceCache->Lookup(bestCollision.m_location, bestCollision.m_normal, cached)) {
+				pathColour = Filter(ray.m_colour, cached);
+				break;
+			}
+			cacheVertices[numCacheVertices++] = CacheVertex{ bestCollision.m_location, bestCollision.m_normal, ray.m_colour };
+		}
+
+		CalculateNextRay(ray, bestCollision, spectral);
+
+		if (material.m_final) {
+			pathColour = ray.m_colour;
+			break;
+		}
+
+		float rayEnergy = Max(ray.m_colour);
+
+		if (rayEnergy < 0.01) break;
+
+		if (collisions > 3) {
+			if (rayEnergy < Rand01()) break;
+			ray.m_colour = ray.m_colour / rayEnergy;
+		}
+
+		++collisions;
+	}
+
+	if (numCacheVertices > 0) RecordCacheVertices(cacheVertices, numCacheVertices, pathColour);
+	if (cost) *cost = pathCost;
+
+	return pathColour;
+}
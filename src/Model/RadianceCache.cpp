@@ -0,0 +1,94 @@
+#include "Model/RadianceCache.h"
+
+#include <cmath>
+
+
+RadianceCache::RadianceCache() :
+	m_entries{ std::make_unique<Entry[]>(RADIANCE_CACHE_ENTRIES) }
+{
+	Clear();
+}
+
+void RadianceCache::Clear() {
+	for (size_t e = 0; e < RADIANCE_CACHE_ENTRIES; ++e) {
+		m_entries[e].m_key.store(0, std::memory_order_relaxed);
+		m_entries[e].m_count.store(0, std::memory_order_relaxed);
+		m_entries[e].m_red.store(0.0f, std::memory_order_relaxed);
+		m_entries[e].m_green.store(0.0f, std::memory_order_relaxed);
+		m_entries[e].m_blue.store(0.0f, std::memory_order_relaxed);
+	}
+}
+
+uint64_t RadianceCache::GetKey(const Vector& location, const Vector& normal) {
+	int64_t x = static_cast<int64_t>(floor(location.m_x / RADIANCE_CACHE_CELL_SIZE));
+	int64_t y = static_cast<int64_t>(floor(location.m_y / RADIANCE_CACHE_CELL_SIZE));
+	int64_t z = static_cast<int64_t>(floor(location.m_z / RADIANCE_CACHE_CELL_SIZE));
+
+	// Normals need not be unit length here, so scale before quantising to {-2..2} per axis
+	float length = Length(normal);
+	int64_t nx = static_cast<int64_t>(lround(2.0f * normal.m_x / length)) + 2;
+	int64_t ny = static_cast<int64_t>(lround(2.0f * normal.m_y / length)) + 2;
+	int64_t nz = static_cast<int64_t>(lround(2.0f * normal.m_z / length)) + 2;
+
+	uint64_t key = static_cast<uint64_t>(x) * 0x9E3779B97F4A7C15ull;
+	key ^= static_cast<uint64_t>(y) * 0xC2B2AE3D27D4EB4Full + (key << 6) + (key >> 2);
+	key ^= static_cast<uint64_t>(z) * 0x165667B19E3779F9ull + (key << 6) + (key >> 2);
+	key ^= static_cast<uint64_t>(nx * 25 + ny * 5 + nz) * 0x27D4EB2F165667C5ull + (key << 6) + (key >> 2);
+
+	return (key == 0) ? 1 : key;
+}
+
+void RadianceCache::Record(const Vector& location, const Vector& normal, const Colour& radiance) {
+	uint64_t key = GetKey(location, normal);
+
+	for (size_t p = 0; p < RADIANCE_CACHE_MAX_PROBES; ++p) {
+		Entry& entry = m_entries[(key + p) % RADIANCE_CACHE_ENTRIES];
+
+		uint64_t existing = entry.m_key.load(std::memory_order_relaxed);
+		if (existing == 0 && entry.m_key.compare_exchange_strong(existing, key, std::memory_order_relaxed)) {
+			existing = key;
+		}
+		if (existing != key) continue;
+
+		if (entry.m_count.load(std::memory_order_relaxed) >= RADIANCE_CACHE_MAX_SAMPLES) return;
+
+		entry.m_red.fetch_add(radiance.m_red, std::memory_order_relaxed);
+		entry.m_green.fetch_add(radiance.m_green, std::memory_order_relaxed);
+		entry.m_blue.fetch_add(radiance.m_blue, std::memory_order_relaxed);
+		entry.m_count.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+}
+
+bool RadianceCache::Lookup(const Vector& location, const Vector& normal, Colour& radiance) const {
+	uint64_t key = GetKey(location, normal);
+
+	for (size_t p = 0; p < RADIANCE_CACHE_MAX_PROBES; ++p) {
+		const Entry& entry = m_entries[(key + p) % RADIANCE_CACHE_ENTRIES];
+
+		uint64_t existing = entry.m_key.load(std::memory_order_relaxed);
+		if (existing == 0) return false;
+		if (existing != key) continue;
+
+		uint32_t count = entry.m_count.load(std::memory_order_relaxed);
+		if (count < RADIANCE_CACHE_MIN_SAMPLES) return false;
+
+		radiance = Colour{
+			1.0f,
+			entry.m_red.load(std::memory_order_relaxed) / count,
+			entry.m_green.load(std::memory_order_relaxed) / count,
+			entry.m_blue.load(std::memory_order_relaxed) / count
+		};
+		return true;
+	}
+
+	return false;
+}
+
+size_t RadianceCache::GetNumEntries() const {
+	size_t entries = 0;
+	for (size_t e = 0; e < RADIANCE_CACHE_ENTRIES; ++e) {
+		if (m_entries[e].m_key.load(std::memory_order_relaxed) != 0) ++entries;
+	}
+	return entries;
+}
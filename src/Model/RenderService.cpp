@@ -0,0 +1,211 @@
+#include "Model/RenderService.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "Model/PathTracer.h"
+#include "Model/Tile.h"
+
+
+struct RenderService::JobState {
+	uint64_t							m_id;
+	RenderJob							m_job;
+	std::shared_ptr<const PathTracer>	m_tracer;
+	std::vector<Tile>					m_tiles;
+	std::vector<size_t>					m_tileSamples;	// a cancelled pass leaves some tiles a sample ahead
+	std::vector<Colour>					m_accumulator;
+	std::chrono::steady_clock::time_point	m_start;
+	size_t								m_samples;
+	std::atomic<size_t>					m_remainingTiles;
+	std::atomic<bool>					m_cancelled;
+	std::promise<RenderResult>			m_promise;
+
+	JobState(uint64_t id, RenderJob job, std::shared_ptr<const PathTracer> tracer) :
+		m_id{id},
+		m_job{std::move(job)},
+		m_tracer{std::move(tracer)},
+		m_tiles{ MakeTiles(m_job.m_width, m_job.m_height, RENDER_JOB_TILE_SIZE) },
+		m_tileSamples(m_tiles.size(), 0),
+		m_accumulator(static_cast<size_t>(m_job.m_width) * m_job.m_height, COLOUR_BLACK),
+		m_start{ std::chrono::steady_clock::now() },
+		m_samples{0},
+		m_remainingTiles{0},
+		m_cancelled{false},
+		m_promise{}
+	{
+	}
+
+	double GetSeconds() const {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+	}
+};
+
+RenderService::RenderService(int numThreads) :
+	m_mutex{},
+	m_jobsFinished{},
+	m_jobs{},
+	m_nextJobId{1},
+	m_tracerMutex{},
+	m_tracers{},
+	m_pool{numThreads}
+{
+}
+
+RenderService::~RenderService() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (auto& [id, job] : m_jobs) job->m_cancelled = true;
+	m_jobsFinished.wait(lock, [this]() { return m_jobs.empty(); });
+}
+
+RenderTicket RenderService::Submit(RenderJob job) {
+	if (!job.m_scene || job.m_width <= 0 || job.m_height <= 0) return RejectJob(std::move(job));
+
+	std::shared_ptr<const PathTracer> tracer = GetTracer(job.m_scene);
+
+	std::shared_ptr<JobState> state;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		uint64_t id = m_nextJobId++;
+		state = std::make_shared<JobState>(id, std::move(job), std::move(tracer));
+		m_jobs.emplace(id, state);
+	}
+
+	RenderTicket ticket{ state->m_id, state->m_promise.get_future() };
+
+	if (state->m_job.m_samplesPerPixel == 0 && state->m_job.m_timeBudget <= 0.0) {
+		// Unbounded job: nothing to trace
+		FinishJob(state);
+		return ticket;
+	}
+
+	SubmitPass(state);
+	return ticket;
+}
+
+// One tracer per live scene, so repeated previews of an unchanged scene reuse its
+// acceleration structures. The build itself runs without holding any lock; if two
+// submissions race to build the same scene, the first one stored wins.
+std::shared_ptr<const PathTracer> RenderService::GetTracer(const std::shared_ptr<const World>& scene) {
+	auto find = [this, &scene]() -> std::shared_ptr<const PathTracer> {
+		std::erase_if(m_tracers, [](const TracerEntry& entry) { return entry.m_scene.expired(); });
+		for (const TracerEntry& entry : m_tracers) {
+			if (entry.m_scene.lock() == scene) return entry.m_tracer;
+		}
+		return nullptr;
+	};
+
+	{
+		std::lock_guard<std::mutex> lock(m_tracerMutex);
+		if (auto tracer = find()) return tracer;
+	}
+
+	auto built = std::make_shared<const PathTracer>(*scene);
+
+	std::lock_guard<std::mutex> lock(m_tracerMutex);
+	if (auto tracer = find()) return tracer;
+
+	m_tracers.push_back(TracerEntry{ scene, built });
+	return built;
+}
+
+bool RenderService::Cancel(uint64_t jobId) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_jobs.find(jobId);
+	if (it == m_jobs.end()) return false;
+
+	it->second->m_cancelled = true;
+	return true;
+}
+
+void RenderService::SubmitPass(const std::shared_ptr<JobState>& job) {
+	job->m_remainingTiles = job->m_tiles.size();
+
+	for (size_t t = 0; t < job->m_tiles.size(); ++t) {
+		m_pool.Submit([this, job, t]() {
+			if (!job->m_cancelled) {
+				TraceTile(*job, t);
+				++job->m_tileSamples[t];
+			}
+			if (job->m_remainingTiles.fetch_sub(1) == 1) CompletePass(job);
+		}, job->m_job.m_priority);
+	}
+}
+
+void RenderService::TraceTile(JobState& job, size_t tile) {
+	const Tile& bounds = job.m_tiles[tile];
+	const RenderJob& desc = job.m_job;
+
+	for (int y = bounds.m_y0; y < bounds.m_y1; ++y) {
+		for (int x = bounds.m_x0; x < bounds.m_x1; ++x) {
+			size_t i = static_cast<size_t>(y) * desc.m_width + x;
+			job.m_accumulator[i] = job.m_accumulator[i] + job.m_tracer->TraceRay(desc.m_viewpoint, x, y, desc.m_width, desc.m_height);
+		}
+	}
+}
+
+void RenderService::CompletePass(const std::shared_ptr<JobState>& job) {
+	const RenderJob& desc = job->m_job;
+
+	if (!job->m_cancelled) {
+		++job->m_samples;
+		if (desc.m_onProgress) desc.m_onProgress(RenderProgress{ job->m_id, job->m_samples, desc.m_samplesPerPixel, job->GetSeconds() });
+	}
+
+	bool samplesDone = desc.m_samplesPerPixel > 0 && job->m_samples >= desc.m_samplesPerPixel;
+	bool timeDone = desc.m_timeBudget > 0.0 && job->GetSeconds() >= desc.m_timeBudget;
+
+	if (job->m_cancelled || samplesDone || timeDone) {
+		FinishJob(job);
+		return;
+	}
+
+	SubmitPass(job);
+}
+
+void RenderService::FinishJob(const std::shared_ptr<JobState>& job) {
+	const RenderJob& desc = job->m_job;
+
+	RenderResult result{ job->m_id, desc.m_width, desc.m_height, job->m_samples, job->GetSeconds(), job->m_cancelled, false, {}, {} };
+	result.m_pixels.resize(job->m_accumulator.size());
+	result.m_radiance.resize(job->m_accumulator.size());
+
+	// Each tile is divided by its own count, since a cancelled pass stops part-way
+	for (size_t t = 0; t < job->m_tiles.size(); ++t) {
+		const Tile& tile = job->m_tiles[t];
+		float samples = (job->m_tileSamples[t] > 0) ? static_cast<float>(job->m_tileSamples[t]) : 1.0f;
+
+		for (int y = tile.m_y0; y < tile.m_y1; ++y) {
+			for (int x = tile.m_x0; x < tile.m_x1; ++x) {
+				size_t i = static_cast<size_t>(y) * desc.m_width + x;
+				result.m_radiance[i] = job->m_accumulator[i] / samples;
+				result.m_pixels[i] = ToUint32( GammaCorrect(result.m_radiance[i]) );
+			}
+		}
+	}
+
+	if (desc.m_onComplete) desc.m_onComplete(result);
+	job->m_promise.set_value(std::move(result));
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_jobs.erase(job->m_id);
+	m_jobsFinished.notify_all();
+}
+
+// A job without a scene or pixels would queue no tiles, so no pass would ever complete it.
+// It resolves at once instead, without being registered.
+RenderTicket RenderService::RejectJob(RenderJob job) {
+	uint64_t id;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		id = m_nextJobId++;
+	}
+
+	std::promise<RenderResult> promise;
+	RenderTicket ticket{ id, promise.get_future() };
+
+	RenderResult result{ id, std::max(job.m_width, 0), std::max(job.m_height, 0), 0, 0.0, false, true, {}, {} };
+	if (job.m_onComplete) job.m_onComplete(result);
+	promise.set_value(std::move(result));
+
+	return ticket;
+}
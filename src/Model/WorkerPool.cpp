@@ -0,0 +1,53 @@
+#include "Model/WorkerPool.h"
+
+
+WorkerPool::WorkerPool(int numThreads) :
+	m_threads{},
+	m_tasks{},
+	m_nextSequence{0},
+	m_mutex{},
+	m_condition{},
+	m_stopping{false}
+{
+	if (numThreads < 1) numThreads = 1;
+
+	for (int t = 0; t < numThreads; ++t) {
+		m_threads.emplace_back([this]() { WorkerLoop(); });
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_condition.notify_all();
+
+	for (auto& th : m_threads) th.join();
+}
+
+void WorkerPool::Submit(std::function<void()> task, int priority) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push(Task{ priority, m_nextSequence++, std::move(task) });
+	}
+	m_condition.notify_one();
+}
+
+void WorkerPool::WorkerLoop() {
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+			// Drain outstanding work before shutting down
+			if (m_tasks.empty()) return;
+
+			// top() is const; the task is popped straight after, so moving out of it is safe
+			task = std::move(const_cast<Task&>(m_tasks.top()).m_function);
+			m_tasks.pop();
+		}
+		task();
+	}
+}
@@ -11,6 +11,8 @@ World::World() :
 	m_cuboids{},
 	m_cuboidLights{},
 	m_spheres{},
+	m_prototypes{},
+	m_instances{},
 	m_viewpoint{ Vector{0.0f, 0.0f, 0.0f}, Vector{ 0.0f, 0.0f, 0.0f } },
 	m_velocity{ 0.0f, 0.0f, 0.0f },
 	m_viewChanged{false}
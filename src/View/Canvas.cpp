@@ -11,7 +11,7 @@ Canvas::Canvas() :
 	SDL_SetRenderDrawBlendMode(m_pRenderer, SDL_BLENDMODE_BLEND);
 }
 
-void Canvas::ApplyPixels(uint32_t* pixels) {
+void Canvas::PublishFrame(const uint32_t* pixels) {
 	SDL_UpdateTexture(m_pTexture, nullptr, pixels, WINDOW_W * sizeof(uint32_t));
     SDL_RenderCopy(m_pRenderer, m_pTexture, nullptr, nullptr);
     SDL_RenderPresent(m_pRenderer);
@@ -0,0 +1,28 @@
+#include "View/ImageWriter.h"
+
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+bool WritePpm(const std::string& path, const uint32_t* pixels, int width, int height) {
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		std::cerr << "Failed to open " << path << " for writing.\n";
+		return false;
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+
+	std::vector<unsigned char> row(width * 3);
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			uint32_t p = pixels[y * width + x];
+			row[x * 3 + 0] = (p >> 16) & 0xFF;
+			row[x * 3 + 1] = (p >> 8) & 0xFF;
+			row[x * 3 + 2] = p & 0xFF;
+		}
+		file.write(reinterpret_cast<const char*>(row.data()), row.size());
+	}
+
+	return static_cast<bool>(file);
+}
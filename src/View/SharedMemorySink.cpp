@@ -0,0 +1,87 @@
+#include "View/SharedMemorySink.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+static_assert(sizeof(SharedFrameHeader) <= SHARED_FRAME_HEADER_SIZE);
+static_assert(sizeof(SharedFrameSlot) <= SHARED_FRAME_SLOT_HEADER_SIZE);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+SharedMemorySink::SharedMemorySink(const std::string& name) :
+	m_name{name},
+	m_size{},
+	m_header{},
+	m_frame{0}
+{
+	size_t slotStride = SHARED_FRAME_SLOT_HEADER_SIZE + NUM_PIXELS * sizeof(uint32_t);
+	slotStride = (slotStride + 63) & ~static_cast<size_t>(63);
+	m_size = SHARED_FRAME_HEADER_SIZE + SHARED_FRAME_SLOTS * slotStride;
+
+	int fd = shm_open(m_name.c_str(), O_CREAT | O_RDWR, 0644);
+	if (fd < 0) {
+		std::cerr << "shm_open(" << m_name << ") failed: " << strerror(errno) << "\n";
+		return;
+	}
+
+	if (ftruncate(fd, m_size) != 0) {
+		std::cerr << "ftruncate(" << m_name << ") failed: " << strerror(errno) << "\n";
+		close(fd);
+		shm_unlink(m_name.c_str());
+		return;
+	}
+
+	void* memory = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+
+	if (memory == MAP_FAILED) {
+		std::cerr << "mmap(" << m_name << ") failed: " << strerror(errno) << "\n";
+		shm_unlink(m_name.c_str());
+		return;
+	}
+
+	m_header = new (memory) SharedFrameHeader{
+		SHARED_FRAME_MAGIC, SHARED_FRAME_VERSION, WINDOW_W, WINDOW_H,
+		SHARED_FRAME_SLOTS, static_cast<uint32_t>(slotStride), {}
+	};
+	m_header->m_latestFrame.store(0, std::memory_order_relaxed);
+
+	for (uint64_t s = 0; s < SHARED_FRAME_SLOTS; ++s) {
+		new (GetSlot(s)) SharedFrameSlot{ {}, 0 };
+		GetSlot(s)->m_sequence.store(0, std::memory_order_relaxed);
+	}
+}
+
+SharedMemorySink::~SharedMemorySink() {
+	if (!m_header) return;
+
+	munmap(m_header, m_size);
+	shm_unlink(m_name.c_str());
+}
+
+SharedFrameSlot* SharedMemorySink::GetSlot(uint64_t frame) {
+	char* base = reinterpret_cast<char*>(m_header) + SHARED_FRAME_HEADER_SIZE;
+	return reinterpret_cast<SharedFrameSlot*>(base + (frame % SHARED_FRAME_SLOTS) * m_header->m_slotStride);
+}
+
+void SharedMemorySink::PublishFrame(const uint32_t* pixels) {
+	if (!m_header) return;
+
+	SharedFrameSlot* slot = GetSlot(m_frame);
+	uint32_t* slotPixels = reinterpret_cast<uint32_t*>(reinterpret_cast<char*>(slot) + SHARED_FRAME_SLOT_HEADER_SIZE);
+
+	slot->m_sequence.store(2 * m_frame + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot->m_frame = m_frame;
+	memcpy(slotPixels, pixels, NUM_PIXELS * sizeof(uint32_t));
+
+	slot->m_sequence.store(2 * m_frame + 2, std::memory_order_release);
+	m_header->m_latestFrame.store(m_frame + 1, std::memory_order_release);
+
+	++m_frame;
+}
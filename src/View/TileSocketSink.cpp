@@ -0,0 +1,162 @@
+#include "View/TileSocketSink.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+
+static bool SetNonBlocking(int socket) {
+	int flags = fcntl(socket, F_GETFL, 0);
+	return flags >= 0 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+TileSocketSink::TileSocketSink(uint16_t port, const std::string& bindAddress) :
+	m_listenSocket{-1},
+	m_clients{},
+	m_frame{0}
+{
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+
+	if (inet_pton(AF_INET, bindAddress.c_str(), &address.sin_addr) != 1) {
+		std::cerr << "Invalid bind address " << bindAddress << "\n";
+		return;
+	}
+
+	int listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	if (listenSocket < 0) {
+		std::cerr << "socket() failed: " << strerror(errno) << "\n";
+		return;
+	}
+
+	int reuse = 1;
+	setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	if (bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+		listen(listenSocket, 4) != 0 || !SetNonBlocking(listenSocket)) {
+		std::cerr << "Failed to listen on " << bindAddress << ":" << port << ": " << strerror(errno) << "\n";
+		close(listenSocket);
+		return;
+	}
+
+	m_listenSocket = listenSocket;
+}
+
+TileSocketSink::~TileSocketSink() {
+	for (auto& client : m_clients) close(client->m_socket);
+	if (m_listenSocket >= 0) close(m_listenSocket);
+}
+
+void TileSocketSink::AcceptClients() {
+	while (true) {
+		int clientSocket = accept(m_listenSocket, nullptr, nullptr);
+		if (clientSocket < 0) return;
+
+		if (!SetNonBlocking(clientSocket)) {
+			close(clientSocket);
+			continue;
+		}
+
+#ifdef SO_NOSIGPIPE
+		int noSigPipe = 1;
+		setsockopt(clientSocket, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+
+		m_clients.push_back(std::make_unique<Client>(Client{ clientSocket, {}, {}, 0 }));
+	}
+}
+
+void TileSocketSink::QueueChangedTiles(Client& client, const uint32_t* pixels) {
+	bool fullFrame = client.m_lastSent.empty();
+	if (fullFrame) client.m_lastSent.assign(NUM_PIXELS, 0);
+
+	std::vector<TileMessageHeader> changed;
+
+	for (int y0 = 0; y0 < WINDOW_H; y0 += SOCKET_TILE_SIZE) {
+		for (int x0 = 0; x0 < WINDOW_W; x0 += SOCKET_TILE_SIZE) {
+			int w = (x0 + SOCKET_TILE_SIZE < WINDOW_W) ? SOCKET_TILE_SIZE : WINDOW_W - x0;
+			int h = (y0 + SOCKET_TILE_SIZE < WINDOW_H) ? SOCKET_TILE_SIZE : WINDOW_H - y0;
+
+			bool differs = fullFrame;
+			for (int y = y0; y < y0 + h && !differs; ++y) {
+				differs = memcmp(&pixels[y * WINDOW_W + x0], &client.m_lastSent[y * WINDOW_W + x0], w * sizeof(uint32_t)) != 0;
+			}
+
+			if (differs) {
+				changed.push_back(TileMessageHeader{
+					SOCKET_TILE_MAGIC, m_frame,
+					static_cast<uint16_t>(x0), static_cast<uint16_t>(y0),
+					static_cast<uint16_t>(w), static_cast<uint16_t>(h), 0
+				});
+			}
+		}
+	}
+
+	if (changed.empty()) return;
+	changed.back().m_lastInFrame = 1;
+
+	for (const TileMessageHeader& tile : changed) {
+		const char* header = reinterpret_cast<const char*>(&tile);
+		client.m_pending.insert(client.m_pending.end(), header, header + sizeof(tile));
+
+		for (int y = tile.m_y; y < tile.m_y + tile.m_height; ++y) {
+			const uint32_t* row = &pixels[y * WINDOW_W + tile.m_x];
+			const char* bytes = reinterpret_cast<const char*>(row);
+			client.m_pending.insert(client.m_pending.end(), bytes, bytes + tile.m_width * sizeof(uint32_t));
+			memcpy(&client.m_lastSent[y * WINDOW_W + tile.m_x], row, tile.m_width * sizeof(uint32_t));
+		}
+	}
+}
+
+bool TileSocketSink::Flush(Client& client) {
+	while (client.m_pendingOffset < client.m_pending.size()) {
+		ssize_t sent = send(client.m_socket, client.m_pending.data() + client.m_pendingOffset,
+			client.m_pending.size() - client.m_pendingOffset, SEND_FLAGS);
+
+		if (sent < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+			if (errno == EINTR) continue;
+			return false;
+		}
+
+		client.m_pendingOffset += sent;
+	}
+
+	client.m_pending.clear();
+	client.m_pendingOffset = 0;
+	return true;
+}
+
+void TileSocketSink::PublishFrame(const uint32_t* pixels) {
+	if (m_listenSocket < 0) return;
+
+	AcceptClients();
+
+	for (auto it = m_clients.begin(); it != m_clients.end();) {
+		Client& client = **it;
+
+		// Only queue a new frame once the previous one has gone out, so a slow client skips frames
+		if (client.m_pending.empty()) QueueChangedTiles(client, pixels);
+
+		if (!Flush(client)) {
+			close(client.m_socket);
+			it = m_clients.erase(it);
+			continue;
+		}
+		++it;
+	}
+
+	++m_frame;
+}
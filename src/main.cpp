@@ -1,9 +1,24 @@
 #include <SDL2/SDL.h>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <csignal>
+#include <exception>
 #include <iostream>
 #include <math.h>
+#include <memory>
+#include <string>
+#include <vector>
 
+#include "Model/BatchRenderer.h"
+#include "Model/CameraPath.h"
+#include "Model/WorkerPool.h"
 #include "Model/World.h"
 #include "View/Canvas.h"
+#include "View/FrameSink.h"
+#include "View/SharedMemorySink.h"
+#include "View/TileSocketSink.h"
 
 #define GPU_BUILD 1
 
@@ -87,6 +102,24 @@ void handle_keyup(World& world, SDL_Event& event) {
     }
 }
 
+#if !GPU_BUILD
+// H toggles the per-pixel cost heatmap, P writes it to cost_heatmap.ppm
+void handle_cost_keydown(Executor& executor, SDL_Event& event) {
+	switch (event.key.keysym.sym) {
+		case SDLK_h:
+			executor.SetShowCost(!executor.IsShowingCost());
+			break;
+
+		case SDLK_p:
+			if (executor.DumpCostHeatmap("cost_heatmap.ppm")) std::cout << "Wrote cost_heatmap.ppm\n";
+			break;
+
+		default:
+			break;
+	}
+}
+#endif
+
 void handle_mouse_motion(World& world, SDL_Event& event, MousePosition& mp) {
 	int x;
 	int y;
@@ -102,16 +135,16 @@ void handle_mouse_motion(World& world, SDL_Event& event, MousePosition& mp) {
 	mp.m_y = y;
 }
 
-void RenderScene(Canvas& canvas, Executor& executor, World& world, uint32_t* buffer) {
+void RenderScene(const std::vector<FrameSink*>& sinks, Executor& executor, World& world, uint32_t* buffer) {
 	executor.TraceRays(buffer);
-	canvas.ApplyPixels(buffer);
+	for (FrameSink* sink : sinks) sink->PublishFrame(buffer);
 	world.SetViewChanged(false);
 }
 
-void Mainloop(Canvas& canvas, World& world, Executor& executor) {
+void Mainloop(const std::vector<FrameSink*>& sinks, World& world, Executor& executor) {
 	uint32_t buffer[NUM_PIXELS];
 
-	RenderScene(canvas, executor, world, buffer);
+	RenderScene(sinks, executor, world, buffer);
 
 	float lastTime = SDL_GetTicks() / 1000.0f;
     float lastFpsTime = lastTime;
@@ -131,6 +164,9 @@ void Mainloop(Canvas& canvas, World& world, Executor& executor) {
 
 				case SDL_KEYDOWN:
                     handle_keydown(world, event);
+#if !GPU_BUILD
+					handle_cost_keydown(executor, event);
+#endif
                     break;
                 
                 case SDL_KEYUP:
@@ -160,18 +196,141 @@ void Mainloop(Canvas& canvas, World& world, Executor& executor) {
 		}
 
 		world.ProcessTimeTick(dt, executor);
-		RenderScene(canvas, executor, world, buffer);
+		RenderScene(sinks, executor, world, buffer);
 
 		lastTime = currentTime;
     }
 }
 
-int main() {
+std::atomic<bool> g_running{true};
+
+void handle_interrupt(int) {
+	g_running = false;
+}
+
+// Renders without a window until interrupted, publishing every frame to the sinks
+void HeadlessLoop(const std::vector<FrameSink*>& sinks, World& world, Executor& executor) {
+	std::vector<uint32_t> buffer(NUM_PIXELS);
+
+	std::signal(SIGINT, handle_interrupt);
+	std::signal(SIGTERM, handle_interrupt);
+
+	auto lastFpsTime = std::chrono::steady_clock::now();
+	int frame_tick = FRAME_RATE_FREQUENCY;
+
+	while (g_running) {
+		RenderScene(sinks, executor, world, buffer.data());
+
+		--frame_tick;
+		if (0 == frame_tick) {
+			auto currentTime = std::chrono::steady_clock::now();
+			float fps = FRAME_RATE_FREQUENCY / std::chrono::duration<float>(currentTime - lastFpsTime).count();
+			std::cout << "fps: " << fps << "\n";
+			frame_tick = FRAME_RATE_FREQUENCY;
+			lastFpsTime = currentTime;
+		}
+	}
+}
+
+// Parses a whole decimal argument in [1, max]; std::stoul alone throws on junk and wraps negatives
+bool ParseCount(const char* text, unsigned long max, unsigned long& value) {
+	std::string arg = text;
+	if (arg.empty() || arg.find_first_not_of("0123456789") != std::string::npos) return false;
+
+	try {
+		value = std::stoul(arg);
+	} catch (const std::exception&) {
+		return false;
+	}
+	return value >= 1 && value <= max;
+}
+
+// main --batch <camera path> <samples per frame> <output prefix> [frames]
+// Without [frames], every keyframe in the path is rendered as one frame.
+int RunBatch(int argc, char** argv) {
+	unsigned long samplesPerFrame = 0;
+	unsigned long frames = 0;
+
+	if (argc < 5 || !ParseCount(argv[3], ULONG_MAX, samplesPerFrame) || (argc > 5 && !ParseCount(argv[5], ULONG_MAX, frames))) {
+		std::cerr << "Usage: " << argv[0] << " --batch <camera path> <samples per frame> <output prefix> [frames]\n";
+		return 1;
+	}
+
+	CameraPath path;
+	if (!path.LoadFromFile(argv[2])) return 1;
+
+	std::string outputPrefix = argv[4];
+
+	std::vector<Viewpoint> viewpoints = (argc > 5) ? path.Sample(frames) : path.GetKeyframeViewpoints();
+
+	World world;
+	WorkerPool pool;
+	BatchRenderer renderer(world, pool);
+	BatchStatistics stats = renderer.Render(viewpoints, samplesPerFrame, outputPrefix);
+
+	return (stats.m_failedWrites > 0) ? 1 : 0;
+}
+
+// main [--headless] [--shm <name>] [--tcp <port> [--tcp-bind <address>]]
+// The tile stream only accepts local connections unless --tcp-bind names another address.
+int main(int argc, char** argv) {
+	if (argc > 1 && std::string(argv[1]) == "--batch") return RunBatch(argc, argv);
+
+	bool headless = false;
+	std::vector<std::unique_ptr<FrameSink>> outputs;
+	unsigned long port = 0;
+	std::string bindAddress = SOCKET_DEFAULT_BIND_ADDRESS;
+	bool customBind = false;
+
+	for (int a = 1; a < argc; ++a) {
+		std::string arg = argv[a];
+		if (arg == "--headless") {
+			headless = true;
+		} else if (arg == "--shm" && a + 1 < argc) {
+			auto sink = std::make_unique<SharedMemorySink>(argv[++a]);
+			if (!sink->IsOpen()) return 1;
+			outputs.push_back(std::move(sink));
+		} else if (arg == "--tcp" && a + 1 < argc && port == 0 && ParseCount(argv[a + 1], UINT16_MAX, port)) {
+			++a;
+		} else if (arg == "--tcp-bind" && a + 1 < argc) {
+			bindAddress = argv[++a];
+			customBind = true;
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--headless] [--shm <name>] [--tcp <port> [--tcp-bind <address>]]\n"
+				<< "       " << argv[0] << " --batch <camera path> <samples per frame> <output prefix> [frames]\n";
+			return 1;
+		}
+	}
+
+	if (customBind && port == 0) {
+		std::cerr << "--tcp-bind needs --tcp <port>\n";
+		return 1;
+	}
+
+	if (port != 0) {
+		auto sink = std::make_unique<TileSocketSink>(static_cast<uint16_t>(port), bindAddress);
+		if (!sink->IsOpen()) return 1;
+		outputs.push_back(std::move(sink));
+	}
+
+	std::vector<FrameSink*> sinks;
+	for (auto& output : outputs) sinks.push_back(output.get());
+
+	if (headless) {
+		World world;
+		Executor executor(world);
+
+		HeadlessLoop(sinks, world, executor);
+		return 0;
+	}
+
     Canvas canvas;
 	World world;
 	Executor executor(world);
 
-    Mainloop(canvas, world, executor);
+	sinks.push_back(&canvas);
+
+    Mainloop(sinks, world, executor);
 
     return 0;
 }